@@ -0,0 +1,325 @@
+#include "Analysis.h"
+
+namespace {
+
+	// Positions not yet analysed by a context: it takes from the front, others steal from the back
+	struct alignas(64) AnalysisRange {
+		std::mutex Mutex;
+		std::size_t Begin = 0;
+		std::size_t End = 0;
+	};
+
+	struct EpdLine {
+		std::size_t Start = 0;
+		std::size_t Length = 0;
+	};
+
+	std::string EscapeJson(const std::string& str) {
+		std::string escaped;
+		escaped.reserve(str.size());
+		for (const char c : str) {
+			if (static_cast<unsigned char>(c) < 0x20) continue;
+			if (c == '"' || c == '\\') escaped += '\\';
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	// Extracts the FEN (with default move counters if they are missing) and the 'id' operation of an EPD line
+	// The piece placement is validated here, as the FEN parser assumes a well-formed input
+	bool ParseEpdLine(const std::string& line, std::string& fen, std::string& id) {
+		const std::vector<std::string> parts = Split(line);
+		if (parts.size() < 4 || (parts[1] != "w" && parts[1] != "b")) return false;
+
+		int ranks = 1, files = 0, whiteKings = 0, blackKings = 0;
+		for (const char c : parts[0]) {
+			if (c == '/') {
+				if (files != 8) return false;
+				ranks += 1;
+				files = 0;
+				continue;
+			}
+			if (c >= '1' && c <= '8') files += c - '0';
+			else if (std::string("PNBRQKpnbrqk").find(c) != std::string::npos) files += 1;
+			else return false;
+			if (c == 'K') whiteKings += 1;
+			if (c == 'k') blackKings += 1;
+			if (files > 8) return false;
+		}
+		if (ranks != 8 || files != 8 || whiteKings != 1 || blackKings != 1) return false;
+
+		const auto isNumber = [](const std::string& str) {
+			return !str.empty() && std::all_of(str.begin(), str.end(), [](const char c) { return c >= '0' && c <= '9'; });
+		};
+		const bool hasCounters = parts.size() >= 6 && isNumber(parts[4]) && isNumber(parts[5]);
+		fen = parts[0] + " " + parts[1] + " " + parts[2] + " " + parts[3] + (hasCounters ? " " + parts[4] + " " + parts[5] : " 0 1");
+
+		id.clear();
+		const std::size_t idStart = line.find("id \"");
+		if (idStart != std::string::npos && (idStart == 0 || line[idStart - 1] == ' ' || line[idStart - 1] == ';')) {
+			const std::size_t idEnd = line.find('"', idStart + 4);
+			if (idEnd != std::string::npos) id = line.substr(idStart + 4, idEnd - idStart - 4);
+		}
+		return true;
+	}
+
+	std::string FormatScore(const int score, const int ply) {
+		if (IsMateScore(score)) {
+			const int movesToMate = (MateEval - std::abs(score) + 1) / 2;
+			return "{\"mate\":" + std::to_string((score > 0) ? movesToMate : -movesToMate) + "}";
+		}
+		return "{\"cp\":" + std::to_string(ToCentipawns(score, ply)) + "}";
+	}
+
+	std::string FormatPv(const std::vector<Move>& moves) {
+		std::string pv = "[";
+		for (const Move& move : moves) {
+			if (pv.size() > 1) pv += ',';
+			pv += '"';
+			pv += move.ToString(Settings::Chess960);
+			pv += '"';
+		}
+		pv += ']';
+		return pv;
+	}
+
+	std::string FormatAnalysisResult(const std::size_t index, const Position& pos, const std::string& id, const Results& r,
+		const std::vector<Results>& rootLines) {
+		const Move bestMove = r.BestMove();
+		std::string result = "{\"index\":";
+		result += std::to_string(index);
+		result += ",\"fen\":\"";
+		result += pos.GetFEN();
+		result += '"';
+		if (!id.empty()) {
+			result += ",\"id\":\"";
+			result += EscapeJson(id);
+			result += '"';
+		}
+		result += ",\"bestmove\":";
+		if (bestMove.IsNull()) result += "null";
+		else {
+			result += '"';
+			result += bestMove.ToString(Settings::Chess960);
+			result += '"';
+		}
+		result += ",\"score\":";
+		result += FormatScore(r.score, pos.GetPly());
+		result += ",\"depth\":";
+		result += std::to_string(r.depth);
+		result += ",\"seldepth\":";
+		result += std::to_string(r.seldepth);
+		result += ",\"nodes\":";
+		result += std::to_string(r.nodes);
+		result += ",\"time_ms\":";
+		result += std::to_string(r.time);
+		result += ",\"pv\":";
+		result += FormatPv(r.pv);
+
+		if (rootLines.size() > 1) {
+			result += ",\"lines\":[";
+			for (std::size_t i = 0; i < rootLines.size(); i++) {
+				if (i != 0) result += ',';
+				result += "{\"multipv\":";
+				result += std::to_string(i + 1);
+				result += ",\"score\":";
+				result += FormatScore(rootLines[i].score, pos.GetPly());
+				result += ",\"pv\":";
+				result += FormatPv(rootLines[i].pv);
+				result += '}';
+			}
+			result += ']';
+		}
+		result += '}';
+		return result;
+	}
+
+}
+
+// Batch EPD analysis -----------------------------------------------------------------------------
+
+bool ParseAnalysisParams(const std::vector<std::string>& parts, AnalysisParams& params) {
+	// Format: analyse <file> [output <file>] [depth <d>] [nodes <n>] [movetime <ms>] [threads <t>] [hash <mb>] [multipv <n>]
+	if (parts.size() < 2 || parts.size() % 2 != 0) {
+		cout << "Usage: analyse <file> [output <file>] [depth <d>] [nodes <n>] [movetime <ms>] [threads <t>] [hash <mb>] [multipv <n>]" << endl;
+		return false;
+	}
+	params.input = parts[1];
+	params.threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+
+	for (std::size_t i = 2; i + 1 < parts.size(); i += 2) {
+		if (parts[i] == "output") params.output = parts[i + 1];
+		else if (parts[i] == "depth") params.depth = std::stoi(parts[i + 1]);
+		else if (parts[i] == "nodes") params.nodes = std::stoi(parts[i + 1]);
+		else if (parts[i] == "movetime") params.movetime = std::stoi(parts[i + 1]);
+		else if (parts[i] == "threads") params.threads = std::stoi(parts[i + 1]);
+		else if (parts[i] == "hash") params.hash = std::stoi(parts[i + 1]);
+		else if (parts[i] == "multipv") params.multiPV = std::stoi(parts[i + 1]);
+		else {
+			cout << "Unknown analysis parameter: '" << parts[i] << "'" << endl;
+			return false;
+		}
+	}
+	if (params.depth == 0 && params.nodes == 0 && params.movetime == 0) params.depth = 12;
+	if (params.depth < 0 || params.depth >= MaxDepth || params.nodes < 0 || params.movetime < 0) {
+		cout << "Invalid search limits" << endl;
+		return false;
+	}
+	if (params.threads < 1 || params.hash < 1 || params.multiPV < 1) {
+		cout << "Invalid thread count, hash size or multi-PV line count" << endl;
+		return false;
+	}
+	return true;
+}
+
+void RunAnalysis(const AnalysisParams& params) {
+	MappedFile input;
+	if (!input.Open(params.input)) {
+		cout << "Could not open " << params.input << endl;
+		return;
+	}
+	std::ofstream file;
+	if (!params.output.empty()) {
+		file.open(params.output);
+		if (!file.is_open()) {
+			cout << "Could not open " << params.output << " for writing" << endl;
+			return;
+		}
+	}
+	std::ostream& output = params.output.empty() ? cout : file;
+
+	// Index the non-empty lines, skipping comments
+	const char* data = reinterpret_cast<const char*>(input.GetData());
+	const std::size_t size = input.GetSize();
+	std::vector<EpdLine> lines;
+	std::size_t start = 0;
+	while (start < size) {
+		const char* newline = static_cast<const char*>(std::memchr(data + start, '\n', size - start));
+		const std::size_t end = (newline != nullptr) ? (newline - data) : size;
+		std::size_t length = end - start;
+		if (length != 0 && data[start + length - 1] == '\r') length -= 1;
+		if (length != 0 && data[start] != '#') lines.push_back({ start, length });
+		start = end + 1;
+	}
+	if (lines.empty()) {
+		cout << "No positions found in " << params.input << endl;
+		return;
+	}
+
+	const std::size_t threadCount = std::min<std::size_t>(params.threads, lines.size());
+	std::vector<AnalysisRange> ranges(threadCount);
+	for (std::size_t i = 0; i < threadCount; i++) {
+		ranges[i].Begin = i * lines.size() / threadCount;
+		ranges[i].End = (i + 1) * lines.size() / threadCount;
+	}
+
+	// Take the next position of our own range, or steal the second half of someone else's
+	// The stolen range is removed from the victim before it becomes ours, so there is never a need to hold both locks
+	const auto takePosition = [&](const std::size_t self, std::size_t& index) {
+		AnalysisRange& own = ranges[self];
+		{
+			std::lock_guard<std::mutex> lock(own.Mutex);
+			if (own.Begin < own.End) {
+				index = own.Begin++;
+				return true;
+			}
+		}
+		for (std::size_t i = 1; i < threadCount; i++) {
+			AnalysisRange& victim = ranges[(self + i) % threadCount];
+			std::size_t stolenBegin = 0, stolenEnd = 0;
+			{
+				std::lock_guard<std::mutex> lock(victim.Mutex);
+				const std::size_t remaining = victim.End - victim.Begin;
+				if (remaining == 0) continue;
+				stolenEnd = victim.End;
+				stolenBegin = victim.End - (remaining + 1) / 2;
+				victim.End = stolenBegin;
+			}
+			std::lock_guard<std::mutex> lock(own.Mutex);
+			own.Begin = stolenBegin + 1;
+			own.End = stolenEnd;
+			index = stolenBegin;
+			return true;
+		}
+		return false;
+	};
+
+	std::mutex outputMutex;
+	std::condition_variable outputCondVar;
+	std::size_t completed = 0;
+	std::atomic<uint64_t> totalNodes = 0, invalid = 0;
+
+	const auto worker = [&](const std::size_t self) {
+		std::unique_ptr<Search> searcher = std::make_unique<Search>(SearchMode::Synchronous);
+		searcher->TranspositionTable.SetSize(params.hash);
+		SearchParams searchParams{};
+		searchParams.depth = params.depth;
+		searchParams.nodes = params.nodes;
+		searchParams.movetime = params.movetime;
+		searchParams.multiPV = params.multiPV;
+
+		std::size_t index = 0;
+		std::string fen, id, result;
+		while (takePosition(self, index)) {
+			const std::string line(data + lines[index].Start, lines[index].Length);
+			bool valid = ParseEpdLine(line, fen, id);
+			if (valid) {
+				const Position pos(fen);
+				const uint64_t opponentKing = (pos.Turn() == Side::White) ? pos.BlackKingBits() : pos.WhiteKingBits();
+				valid = (pos.CalculateAttackedSquares(pos.Turn()) & opponentKing) == 0;
+
+				if (valid) {
+					MoveList legalMoves{};
+					pos.GenerateMoves(legalMoves, MoveGen::All, Legality::Legal);
+					Results r{};
+					std::vector<Results> rootLines{};
+					if (legalMoves.size() == 0) {
+						r.score = pos.IsInCheck() ? -MateEval : 0;
+					}
+					else {
+						// Clearing the state makes the results independent of which context got the position
+						searcher->ResetState(true);
+						r = searcher->SearchSinglethreaded(pos, searchParams);
+						rootLines = searcher->Threads.front().RootLines;
+					}
+					totalNodes.fetch_add(r.nodes, std::memory_order_relaxed);
+					result = FormatAnalysisResult(index, pos, id, r, rootLines);
+				}
+			}
+			if (!valid) {
+				invalid.fetch_add(1, std::memory_order_relaxed);
+				result = "{\"index\":" + std::to_string(index) + ",\"error\":\"invalid position\",\"line\":\"" + EscapeJson(line) + "\"}";
+			}
+
+			std::unique_lock<std::mutex> lock(outputMutex);
+			output << result << '\n' << std::flush;
+			completed += 1;
+			lock.unlock();
+			outputCondVar.notify_all();
+		}
+	};
+
+	if (!params.output.empty()) {
+		cout << "Analysing " << Console::FormatInteger(lines.size()) << " positions from " << params.input
+			<< " on " << threadCount << " threads" << endl;
+	}
+	const auto startTime = Clock::now();
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < threadCount; i++) threads.emplace_back(worker, i);
+
+	// Report progress while the threads are running, unless the results themselves go to the console
+	const auto report = [&] {
+		const uint64_t seconds = (Clock::now() - startTime).count() / 1000000000;
+		cout << "Positions: " << Console::FormatInteger(completed) << " / " << Console::FormatInteger(lines.size())
+			<< " | Time: " << seconds << " s | Nodes: " << Console::FormatInteger(totalNodes.load(std::memory_order_relaxed)) << endl;
+	};
+	if (!params.output.empty()) {
+		std::unique_lock<std::mutex> lock(outputMutex);
+		while (!outputCondVar.wait_for(lock, std::chrono::seconds(5), [&] { return completed == lines.size(); })) report();
+	}
+	for (std::thread& t : threads) t.join();
+	file.close();
+
+	if (!params.output.empty()) report();
+	if (invalid.load() != 0) cout << "Skipped " << Console::FormatInteger(invalid.load()) << " invalid positions" << endl;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "MappedFile.h"
+#include "Position.h"
+#include "Search.h"
+#include "Settings.h"
+#include "Utils.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Batch analysis of EPD files, for example 'analyse positions.epd output results.jsonl depth 16 threads 8'
+// Every position is searched from scratch by one of several independent single-threaded search contexts,
+// and the results are written as JSON lines in the order they complete ('index' is the position's order
+// in the file). Each context starts with a contiguous range of positions, and once it runs out it steals
+// half of what is left from another one, so uneven search times don't leave threads idle at the end.
+// With 'multipv <n>' the best n lines are added as a 'lines' array.
+
+struct AnalysisParams {
+	std::string input;
+	std::string output; // standard output if empty
+	int threads = 1;
+	int hash = 16;
+	int depth = 0;
+	int nodes = 0;
+	int movetime = 0;
+	int multiPV = 1;
+};
+
+bool ParseAnalysisParams(const std::vector<std::string>& parts, AnalysisParams& params);
+void RunAnalysis(const AnalysisParams& params);
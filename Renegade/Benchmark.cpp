@@ -0,0 +1,354 @@
+#include "Benchmark.h"
+
+// Scaling bench ----------------------------------------------------------------------------------
+
+bool ParseScalingBenchParams(const std::vector<std::string>& parts, ScalingBenchParams& params) {
+	// Format: bench [threads <n>] [hash <mb>] [depth <d> | movetime <ms>]
+	params.threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+	for (std::size_t i = 1; i + 1 < parts.size(); i += 2) {
+		const int value = std::stoi(parts[i + 1]);
+		if (parts[i] == "threads") params.threads = value;
+		else if (parts[i] == "hash") params.hash = value;
+		else if (parts[i] == "depth") params.depth = value;
+		else if (parts[i] == "movetime") params.movetime = value;
+		else {
+			cout << "Unknown bench parameter: '" << parts[i] << "'" << endl;
+			return false;
+		}
+	}
+	if (params.depth == 0 && params.movetime == 0) params.depth = 14;
+
+	if (params.threads < ThreadsMin || params.threads > ThreadsMax) {
+		cout << "Thread count must be between " << ThreadsMin << " and " << ThreadsMax << endl;
+		return false;
+	}
+	if (params.hash < HashMin || params.hash > HashMax) {
+		cout << "Hash size must be between " << HashMin << " and " << HashMax << endl;
+		return false;
+	}
+	if (params.depth != 0 && params.movetime != 0) {
+		cout << "Either depth or movetime should be given, not both" << endl;
+		return false;
+	}
+	return true;
+}
+
+static ScalingBenchEntry RunSuite(Search& search, const ScalingBenchParams& params, const int threads) {
+	ScalingBenchEntry entry{};
+	entry.threads = threads;
+
+	SearchParams searchParams{};
+	searchParams.depth = params.depth;
+	searchParams.movetime = params.movetime;
+	uint64_t elapsedNs = 0;
+
+	for (std::string fen : BenchmarkFENs) {
+		Settings::Chess960 = StartsWith(fen, "[frc]");
+		if (StartsWith(fen, "[frc]")) fen = fen.substr(6, fen.length() - 6);
+		search.ResetState(true);
+		Position pos = Position(fen);
+
+		const auto startTime = Clock::now();
+		search.StartSearch(pos, searchParams, false);
+		search.WaitUntilReady();
+		const auto endTime = Clock::now();
+
+		const Results r = search.GetLastResults();
+		entry.nodes += r.nodes;
+		entry.depthSum += r.depth;
+		elapsedNs += (endTime - startTime).count();
+	}
+
+	entry.timeMs = elapsedNs / 1'000'000;
+	entry.nps = static_cast<uint64_t>(entry.nodes * 1e9 / std::max(elapsedNs, uint64_t{1}));
+	return entry;
+}
+
+void RunScalingBench(Search& search, const ScalingBenchParams& params) {
+	const int oldHashSize = Settings::Hash;
+	const int oldThreadCount = Settings::Threads;
+	const bool oldChess960Setting = Settings::Chess960;
+	search.TranspositionTable.SetSize(params.hash);
+
+	// Thread counts to be tested: powers of two, and the requested maximum
+	std::vector<int> threadCounts{};
+	for (int threads = 1; threads < params.threads; threads *= 2) threadCounts.push_back(threads);
+	threadCounts.push_back(params.threads);
+
+	const bool depthMode = params.depth != 0;
+	cout << "Scaling bench: " << (depthMode ? "depth " + std::to_string(params.depth) : "movetime " + std::to_string(params.movetime) + " ms")
+		<< ", hash " << params.hash << " MB, " << BenchmarkFENs.size() << " positions" << endl;
+	cout << " Threads           Nodes      Time         NPS   NPS speedup   " << (depthMode ? "TTD speedup" : "  Avg depth") << endl;
+
+	const std::ios_base::fmtflags oldFlags = cout.flags();
+	const std::streamsize oldPrecision = cout.precision();
+	std::vector<ScalingBenchEntry> entries{};
+
+	for (const int threads : threadCounts) {
+		Settings::Threads = threads;
+		search.SetThreadCount(threads);
+		const ScalingBenchEntry entry = RunSuite(search, params, threads);
+		entries.push_back(entry);
+
+		const ScalingBenchEntry& base = entries.front();
+		const double npsSpeedup = static_cast<double>(entry.nps) / std::max(base.nps, uint64_t{1});
+		const double ttdSpeedup = static_cast<double>(base.timeMs) / std::max(entry.timeMs, uint64_t{1});
+		const double avgDepth = static_cast<double>(entry.depthSum) / BenchmarkFENs.size();
+
+		cout << std::fixed << std::setw(8) << entry.threads
+			<< std::setw(16) << Console::FormatInteger(entry.nodes)
+			<< std::setw(9) << std::setprecision(2) << entry.timeMs / 1000.0 << "s"
+			<< std::setw(12) << Console::FormatInteger(entry.nps)
+			<< std::setw(13) << std::setprecision(2) << npsSpeedup << "x"
+			<< std::setw(13) << std::setprecision(2) << (depthMode ? ttdSpeedup : avgDepth) << (depthMode ? "x" : " ") << endl;
+	}
+
+	cout.flags(oldFlags);
+	cout.precision(oldPrecision);
+
+	// Restore the previous state
+	Settings::Hash = oldHashSize;
+	Settings::Threads = oldThreadCount;
+	Settings::Chess960 = oldChess960Setting;
+	search.SetThreadCount(oldThreadCount);
+	search.TranspositionTable.SetSize(oldHashSize);
+	search.DisplayOutput = true;
+}
+
+// Bench report -----------------------------------------------------------------------------------
+
+bool ParseBenchReportParams(const std::vector<std::string>& parts, BenchReportParams& params) {
+	// Format: bench report <file> [depth <d>], the format is CSV for .csv files, JSON lines otherwise
+	if (parts.size() < 3) {
+		cout << "Usage: bench report <file> [depth <d>]" << endl;
+		return false;
+	}
+	params.path = parts[2];
+	params.format = EndsWith(params.path, ".csv") ? BenchReportFormat::CSV : BenchReportFormat::JsonLines;
+
+	for (std::size_t i = 3; i + 1 < parts.size(); i += 2) {
+		if (parts[i] == "depth") params.depth = std::stoi(parts[i + 1]);
+		else {
+			cout << "Unknown bench report parameter: '" << parts[i] << "'" << endl;
+			return false;
+		}
+	}
+	if (params.depth < 1 || params.depth >= MaxDepth) {
+		cout << "Invalid depth" << endl;
+		return false;
+	}
+	return true;
+}
+
+void RunBenchReport(Search& search, const BenchReportParams& params) {
+	std::ofstream file(params.path);
+	if (!file.is_open()) {
+		cout << "Could not open '" << params.path << "' for writing" << endl;
+		return;
+	}
+
+	// Same conditions as the regular bench
+	const int oldHashSize = Settings::Hash;
+	const bool oldChess960Setting = Settings::Chess960;
+	Settings::Hash = 16;
+	search.TranspositionTable.SetSize(16);
+	if (search.Threads.size() != 1) search.SetThreadCount(1);
+
+	const bool csv = params.format == BenchReportFormat::CSV;
+	if (csv) file << "index,fen,chess960,nodes,time_ms,nps,depth,seldepth,tt_probes,tt_hits,tt_hit_rate,eval_ms,movegen_ms,makemove_ms,profiler";
+	if (csv && StatisticsEnabled) for (const char* name : SearchStatNames) file << "," << name;
+	if (csv) file << "\n";
+	file << std::fixed;
+
+	SearchParams searchParams{};
+	searchParams.depth = params.depth;
+	uint64_t totalNodes = 0;
+	uint64_t totalNs = 0;
+	int index = 0;
+
+	for (std::string fen : BenchmarkFENs) {
+		Settings::Chess960 = StartsWith(fen, "[frc]");
+		if (StartsWith(fen, "[frc]")) fen = fen.substr(6, fen.length() - 6);
+		search.ResetState(false);
+		const Position pos = Position(fen);
+		Profiler::Reset();
+
+		const auto startTime = Clock::now();
+		const Results r = search.SearchSinglethreaded(pos, searchParams);
+		const auto endTime = Clock::now();
+
+		const ThreadData& t = search.Threads.front();
+		const uint64_t elapsedNs = std::max<uint64_t>((endTime - startTime).count(), 1);
+		const uint64_t nps = static_cast<uint64_t>(r.nodes * 1e9 / elapsedNs);
+		const double hitRate = (t.TTProbes != 0) ? static_cast<double>(t.TTHits) / t.TTProbes : 0.0;
+		const ProfilerReport c = Profiler::Collect();
+		const SearchStatistics stats = search.GetLastStatistics();
+		totalNodes += r.nodes;
+		totalNs += elapsedNs;
+
+		if (csv) {
+			file << index << ",\"" << fen << "\"," << Settings::Chess960 << "," << r.nodes << "," << std::setprecision(3) << elapsedNs / 1e6 << ","
+				<< nps << "," << r.depth << "," << r.seldepth << "," << t.TTProbes << "," << t.TTHits << "," << std::setprecision(4) << hitRate << ","
+				<< std::setprecision(3) << c.Milliseconds(ProfilerPhase::Evaluate) << "," << c.Milliseconds(ProfilerPhase::GenerateMoves) << ","
+				<< c.Milliseconds(ProfilerPhase::MakeMove) << "," << ProfilerEnabled;
+			if (StatisticsEnabled) for (const uint64_t count : stats.Counts) file << "," << count;
+			file << "\n";
+		}
+		else {
+			file << "{\"index\":" << index << ",\"fen\":\"" << fen << "\",\"chess960\":" << (Settings::Chess960 ? "true" : "false")
+				<< ",\"nodes\":" << r.nodes << ",\"time_ms\":" << std::setprecision(3) << elapsedNs / 1e6 << ",\"nps\":" << nps
+				<< ",\"depth\":" << r.depth << ",\"seldepth\":" << r.seldepth
+				<< ",\"tt_probes\":" << t.TTProbes << ",\"tt_hits\":" << t.TTHits << ",\"tt_hit_rate\":" << std::setprecision(4) << hitRate
+				<< ",\"eval_ms\":" << std::setprecision(3) << c.Milliseconds(ProfilerPhase::Evaluate)
+				<< ",\"movegen_ms\":" << c.Milliseconds(ProfilerPhase::GenerateMoves)
+				<< ",\"makemove_ms\":" << c.Milliseconds(ProfilerPhase::MakeMove)
+				<< ",\"profiler\":" << (ProfilerEnabled ? "true" : "false");
+			if (StatisticsEnabled) {
+				file << ",\"stats\":{";
+				for (int i = 0; i < SearchStatCount; i++) file << (i != 0 ? "," : "") << "\"" << SearchStatNames[i] << "\":" << stats.Counts[i];
+				file << "}";
+			}
+			file << "}\n";
+		}
+		index += 1;
+	}
+	file.close();
+
+	const uint64_t totalNps = static_cast<uint64_t>(totalNodes * 1e9 / std::max<uint64_t>(totalNs, 1));
+	cout << totalNodes << " nodes " << totalNps << " nps" << endl;
+	cout << "Bench report written to '" << params.path << "' (" << (csv ? "CSV" : "JSON lines")
+		<< (ProfilerEnabled ? "" : ", phase timings require a profiler build") << ")" << endl;
+
+	search.ResetState(false);
+	Settings::Hash = oldHashSize;
+	search.TranspositionTable.SetSize(oldHashSize);
+	Settings::Chess960 = oldChess960Setting;
+	if (search.Threads.size() != static_cast<std::size_t>(Settings::Threads)) search.SetThreadCount(Settings::Threads);
+}
+
+// Movegen bench ----------------------------------------------------------------------------------
+
+bool LoadMovegenBenchFENs(const std::vector<std::string>& parts, std::vector<std::string>& fens) {
+	// Format: benchmovegen [file], the file has one FEN per line ('[frc] ' prefix for Chess960)
+	if (parts.size() < 2) {
+		fens.assign(BenchmarkFENs.begin(), BenchmarkFENs.end());
+		return true;
+	}
+
+	std::ifstream file(parts[1]);
+	if (!file.is_open()) {
+		cout << "Could not open '" << parts[1] << "'" << endl;
+		return false;
+	}
+	std::string line;
+	while (std::getline(file, line)) {
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (line.empty() || line[0] == '#') continue;
+		fens.push_back(line);
+	}
+	if (fens.empty()) {
+		cout << "No positions found in '" << parts[1] << "'" << endl;
+		return false;
+	}
+	return true;
+}
+
+static volatile uint64_t MovegenBenchSink = 0;
+
+struct MovegenBenchPosition {
+	Position position;
+	bool chess960 = false;
+	MoveList pseudolegalMoves{};
+	MoveList legalMoves{};
+	MoveList noisyMoves{};
+};
+
+template <typename Operation>
+static double MeasureNsPerOp(std::vector<MovegenBenchPosition>& positions, uint64_t& ops, const Operation& operation) {
+	// Runs the operation on each position repeatedly, until enough time has passed for a stable measurement
+	// The operation returns how many times the measured primitive was executed
+	ops = 0;
+	uint64_t elapsedNs = 0;
+	const auto startTime = Clock::now();
+	do {
+		for (MovegenBenchPosition& p : positions) {
+			Settings::Chess960 = p.chess960;
+			ops += operation(p);
+		}
+		elapsedNs = (Clock::now() - startTime).count();
+	} while (elapsedNs < 250'000'000 && ops != 0);
+	return (ops != 0) ? static_cast<double>(elapsedNs) / ops : 0.0;
+}
+
+void RunMovegenBench(const std::vector<std::string>& fens) {
+	const bool oldChess960Setting = Settings::Chess960;
+
+	std::vector<MovegenBenchPosition> positions{};
+	for (std::string fen : fens) {
+		MovegenBenchPosition p{};
+		p.chess960 = StartsWith(fen, "[frc]");
+		if (p.chess960) fen = fen.substr(6, fen.length() - 6);
+		Settings::Chess960 = p.chess960;
+		p.position = Position(fen);
+		p.position.GenerateMoves(p.pseudolegalMoves, MoveGen::All, Legality::Pseudolegal);
+		p.position.GenerateMoves(p.legalMoves, MoveGen::All, Legality::Legal);
+		p.position.GenerateMoves(p.noisyMoves, MoveGen::Noisy, Legality::Pseudolegal);
+		positions.push_back(p);
+	}
+
+	// The checksum is written to a volatile at the end, which keeps the compiler from optimizing the work away
+	uint64_t checksum = 0;
+	cout << "Movegen bench: " << positions.size() << " positions, " << GetSliderBackendName() << " slider attacks" << endl;
+	cout << " Operation                            ns/op             ops" << endl;
+
+	const auto report = [&](const std::string& name, const auto& operation) {
+		uint64_t ops = 0;
+		const double nsPerOp = MeasureNsPerOp(positions, ops, operation);
+		cout << " " << std::left << std::setw(30) << name << std::right << std::setw(11) << std::fixed << std::setprecision(1)
+			<< nsPerOp << std::setw(16) << Console::FormatInteger(ops) << endl;
+	};
+
+	report("GenerateMoves (all)", [&](MovegenBenchPosition& p) {
+		MoveList moves{};
+		p.position.GenerateMoves(moves, MoveGen::All, Legality::Pseudolegal);
+		checksum += moves.size();
+		return 1;
+	});
+	report("GenerateMoves (noisy)", [&](MovegenBenchPosition& p) {
+		MoveList moves{};
+		p.position.GenerateMoves(moves, MoveGen::Noisy, Legality::Pseudolegal);
+		checksum += moves.size();
+		return 1;
+	});
+	report("IsLegalMove", [&](MovegenBenchPosition& p) {
+		for (const auto& m : p.pseudolegalMoves) checksum += p.position.IsLegalMove(m.move);
+		return p.pseudolegalMoves.size();
+	});
+	report("PushMove + PopMove", [&](MovegenBenchPosition& p) {
+		for (const auto& m : p.legalMoves) {
+			p.position.PushMove(m.move);
+			checksum += p.position.Hash();
+			p.position.PopMove();
+		}
+		return p.legalMoves.size();
+	});
+	report("StaticExchangeEval", [&](MovegenBenchPosition& p) {
+		for (const auto& m : p.noisyMoves) checksum += p.position.StaticExchangeEval(m.move, 0);
+		return p.noisyMoves.size();
+	});
+	report("StaticExchangeValue", [&](MovegenBenchPosition& p) {
+		const SeeContext context = p.position.GetSeeContext();
+		for (const auto& m : p.noisyMoves) checksum += p.position.StaticExchangeValue(m.move, context);
+		return p.noisyMoves.size();
+	});
+	report("CalculateAttackedSquares", [&](MovegenBenchPosition& p) {
+		checksum += p.position.CalculateAttackedSquares(Side::White);
+		checksum += p.position.CalculateAttackedSquares(Side::Black);
+		return 2;
+	});
+
+	MovegenBenchSink = checksum;
+	cout.unsetf(std::ios_base::floatfield);
+	Settings::Chess960 = oldChess960Setting;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "Magics.h"
+#include "Position.h"
+#include "Profiler.h"
+#include "Search.h"
+#include "Settings.h"
+#include "Utils.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Benchmarking tools going beyond the standard 'bench' command
+// The scaling bench runs the benchmark suite with an increasing number of threads, which helps
+// catching SMP regressions and estimating the hardware needed
+// The bench report writes machine-readable per-position results (JSON lines or CSV) to a file,
+// phase timings are only filled in for profiler builds, and search statistics are only added when enabled
+// The movegen bench times move generation related primitives in isolation, reporting the time per operation
+
+struct ScalingBenchParams {
+	int threads = 1;
+	int hash = 16;
+	int depth = 0;
+	int movetime = 0;
+};
+
+struct ScalingBenchEntry {
+	int threads = 0;
+	uint64_t nodes = 0;
+	uint64_t timeMs = 0;
+	uint64_t nps = 0;
+	int depthSum = 0;
+};
+
+enum class BenchReportFormat { JsonLines, CSV };
+
+struct BenchReportParams {
+	std::string path;
+	BenchReportFormat format = BenchReportFormat::JsonLines;
+	int depth = 14;
+};
+
+bool ParseScalingBenchParams(const std::vector<std::string>& parts, ScalingBenchParams& params);
+void RunScalingBench(Search& search, const ScalingBenchParams& params);
+bool ParseBenchReportParams(const std::vector<std::string>& parts, BenchReportParams& params);
+void RunBenchReport(Search& search, const BenchReportParams& params);
+bool LoadMovegenBenchFENs(const std::vector<std::string>& parts, std::vector<std::string>& fens);
+void RunMovegenBench(const std::vector<std::string>& fens);
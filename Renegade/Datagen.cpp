@@ -1,4 +1,4 @@
-/*#include "Datagen.h"
+#include "Datagen.h"
 
 static void SetTitle(const std::string title) {
 	Console::ClearScreen();
@@ -12,9 +12,67 @@ static void PressEnterToExit() {
 	cin.get();
 }
 
-// Self-play datagen ------------------------------------------------------------------------------ 
+// Writing the output ----------------------------------------------------------------------------
 
-void SelfPlay(const std::string filename);  // main loop per thread, forward declaring this
+DatagenWriter::DatagenWriter(const std::string& filename, const std::size_t capacity) {
+	File.open(filename, std::ios_base::app | std::ios_base::binary);
+	Capacity = std::max<std::size_t>(capacity, 1);
+	Thread = std::thread([this] { Loop(); });
+}
+
+DatagenWriter::~DatagenWriter() {
+	Close();
+}
+
+bool DatagenWriter::IsOpen() const {
+	return File.is_open();
+}
+
+void DatagenWriter::Push(std::string&& game) {
+	std::unique_lock<std::mutex> lock(Mutex);
+	NotFull.wait(lock, [&] { return Queue.size() < Capacity || Closing; });
+	if (Closing) return;
+	Queue.push_back(std::move(game));
+	lock.unlock();
+	NotEmpty.notify_one();
+}
+
+void DatagenWriter::Close() {
+	std::unique_lock<std::mutex> lock(Mutex);
+	Closing = true;
+	lock.unlock();
+	NotEmpty.notify_all();
+	NotFull.notify_all();
+	if (Thread.joinable()) Thread.join();
+	File.close();
+}
+
+void DatagenWriter::Loop() {
+	std::deque<std::string> pending;
+	while (true) {
+		// Take everything that is queued at once, and write it without holding the lock
+		std::unique_lock<std::mutex> lock(Mutex);
+		NotEmpty.wait(lock, [&] { return !Queue.empty() || Closing; });
+		if (Queue.empty() && Closing) break;
+		std::swap(pending, Queue);
+		lock.unlock();
+		NotFull.notify_all();
+
+		for (const std::string& game : pending) File << game;
+		pending.clear();
+
+		// Flush when caught up, so that an interrupted run loses as little as possible
+		lock.lock();
+		const bool caughtUp = Queue.empty();
+		lock.unlock();
+		if (caughtUp) File.flush();
+	}
+	File.flush();
+}
+
+// Self-play datagen ------------------------------------------------------------------------------
+
+static void SelfPlay(DatagenWriter& writer);  // main loop per thread, forward declaring this
 
 std::atomic<uint64_t> PositionsAccepted = 0, PositionsTotal = 0;
 std::atomic<uint64_t> Games = 0, Plies = 0, Searches = 0, Depths = 0, Nodes = 0;
@@ -27,33 +85,20 @@ std::vector<std::string> Openings{};
 static std::string FormatRuntime(const int seconds) {
 	const auto [minutes, s] = std::div(seconds, 60);
 	const auto [h, m] = std::div(minutes, 60);
-	return std::format("{}:{:02d}:{:02d}", h, m, s);
+	std::stringstream ss;
+	ss << h << ':' << std::setfill('0') << std::setw(2) << m << ':' << std::setw(2) << s;
+	return ss.str();
 }
 
 static bool Filter(const Position& pos, const Move& move, const int eval) {
 	if (std::abs(eval) > MateThreshold) return true;
 	if (pos.GetPly() < minSavePly) return true;
-	if (DFRC && move.IsCastling()) return true;
+	if (Settings::Chess960 && move.IsCastling()) return true;
 	if (!pos.IsMoveQuiet(move)) return true;
 	if (pos.IsInCheck()) return true;
 	return false;
 }
 
-static std::string ToTextformat(const std::string fen, const int16_t whiteScore, const GameState outcome) {
-	// Format: <fen> | <eval> | <wdl>
-	// eval: white pov in cp, wdl 1.0 = white win, 0.0 = black win
-
-	const std::string outcomeStr = [&] {
-		switch (outcome) {
-		case GameState::WhiteVictory: return "1.0";
-		case GameState::BlackVictory: return "0.0";
-		case GameState::Drawn: return "0.5";
-		default: return "???";
-		}
-		}();
-	return fen + " | " + std::to_string(whiteScore) + " | " + outcomeStr;
-}
-
 void StartDatagen(const DatagenLaunchMode launchMode) {
 
 	// There is a streamlined way to launch datagen (normal and dfrc) from the command line using the default settings
@@ -65,6 +110,7 @@ void StartDatagen(const DatagenLaunchMode launchMode) {
 	if (launchMode == DatagenLaunchMode::Ask) {
 		cout << "Filename? " << Console::Yellow;
 		cin >> filename;
+		if (GetTrainingDataFormat(filename) != TrainingDataFormat::Games) filename += ".games";
 
 		cout << Console::White << "How many threads? " << Console::Yellow;
 		cin >> ThreadCount;
@@ -76,7 +122,7 @@ void StartDatagen(const DatagenLaunchMode launchMode) {
 	else {
 		const auto time = std::chrono::system_clock::now().time_since_epoch();
 		const uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(time).count();
-		filename = "datagen_" + std::to_string(timestamp);
+		filename = "datagen_" + std::to_string(timestamp) + ".games";
 		ThreadCount = std::thread::hardware_concurrency();
 		DFRC = launchMode == DatagenLaunchMode::DFRC;
 		
@@ -117,28 +163,26 @@ void StartDatagen(const DatagenLaunchMode launchMode) {
 	if (!DFRC) cout << " - The opening book has " << Console::Yellow << Console::FormatInteger(Openings.size()) << Console::White << " lines" << endl;
 	cout << endl;
 
-	std::vector<std::thread> threads = std::vector<std::thread>();
-	for (int i = 0; i < ThreadCount; i++) {
-		std::string filenameForThread = filename + "_" + std::to_string(i + 1);
-		threads.emplace_back(&SelfPlay, filenameForThread);
+	// All threads write into the same file through the writer thread
+	DatagenWriter writer(filename, static_cast<std::size_t>(ThreadCount) * writerQueueGamesPerThread);
+	if (!writer.IsOpen()) {
+		cout << Console::Red << "Could not open " << filename << " for writing." << Console::White << endl;
+		PressEnterToExit();
+		return;
 	}
+
+	std::vector<std::thread> threads = std::vector<std::thread>();
+	for (int i = 0; i < ThreadCount; i++) threads.emplace_back(&SelfPlay, std::ref(writer));
 	for (std::thread& t : threads) t.join();
 }
 
-void SelfPlay(const std::string filename) {
-
-	Search* Searcher1 = new Search;
-	Search* Searcher2 = new Search;
-	Search* SearcherV = new Search;
-	Searcher1->TranspositionTable.SetSize(1);
-	Searcher2->TranspositionTable.SetSize(1);
-	SearcherV->TranspositionTable.SetSize(1);
-	Searcher1->SetThreadCount(1);
-	Searcher2->SetThreadCount(1);
-	SearcherV->SetThreadCount(1);
-	Searcher1->DatagenMode = true;
-	Searcher2->DatagenMode = true;
-	SearcherV->DatagenMode = true;
+static void SelfPlay(DatagenWriter& writer) {
+
+	// A single synchronous search context per thread is used for the verification and for both sides of the game,
+	// its state is reset between the phases instead of keeping separate copies around
+	std::unique_ptr<Search> searcher = std::make_unique<Search>(SearchMode::Synchronous);
+	searcher->TranspositionTable.SetSize(1);
+	searcher->DatagenMode = true;
 
 	SearchParams params = SearchParams();
 	params.softnodes = softNodeLimit;
@@ -152,8 +196,8 @@ void SelfPlay(const std::string filename) {
 	int gamesOnThread = 0;
 	std::mt19937 generator(std::random_device{}());
 
-	std::vector<std::pair<std::string, int>> currentGame{};
-	std::vector<std::string> unsavedLines{};
+	std::vector<PackedMoveAndScore> currentGame{};
+	std::string gameBytes{};
 
 
 	while (true) {
@@ -203,14 +247,14 @@ void SelfPlay(const std::string filename) {
 		if (moves.size() == 0) continue;
 
 		// 3. Verify evaluation if acceptable
-		const Results verificationResults = SearcherV->SearchSinglethreaded(position, verificationParams);
-		SearcherV->ResetState(true);
+		searcher->ResetState(true);
+		const Results verificationResults = searcher->SearchSinglethreaded(position, verificationParams);
 
 		if (std::abs(verificationResults.score) > startingEvalLimit) failed = true;
 		if (failed) continue;
 
-		Searcher1->ResetState(true);
-		Searcher2->ResetState(true);
+		searcher->ResetState(true);
+		PackedPosition startingPosition = PackPosition(position, 0, GameState::Playing);
 
 		// 4. Play out the game
 		while (true) {
@@ -218,8 +262,7 @@ void SelfPlay(const std::string filename) {
 			// Search
 			SearchParams currentParams = params;
 			currentParams.softnodes = nodesDistribution(generator);
-			Search* currentSearcher = (position.Turn() == Side::White) ? Searcher1 : Searcher2;
-			const Results results = currentSearcher->SearchSinglethreaded(position, currentParams);
+			const Results results = searcher->SearchSinglethreaded(position, currentParams);
 			const Move move = results.BestMove();
 			const int whiteScore = results.score * (position.Turn() == Side::Black ? -1 : 1);
 
@@ -261,8 +304,8 @@ void SelfPlay(const std::string filename) {
 			
 			if (!Filter(position, move, results.score)) {
 				PositionsAccepted.fetch_add(1, std::memory_order_relaxed);
-				currentGame.push_back(std::pair(position.GetFEN(), whiteScore));
 			}
+			currentGame.push_back({ move.Pack(), static_cast<int16_t>(whiteScore) });
 			position.PushMove(move);
 
 			outcome = position.GetGameState();
@@ -272,27 +315,22 @@ void SelfPlay(const std::string filename) {
 		if (failed) continue;
 
 		gamesOnThread += 1;
-		Games.fetch_add(1, std::memory_order_relaxed);
+		const uint64_t games = Games.fetch_add(1, std::memory_order_relaxed) + 1;
 		Plies.fetch_add(position.GetPly(), std::memory_order_relaxed);
 
 		if (outcome == GameState::WhiteVictory) WhiteWins.fetch_add(1, std::memory_order_relaxed);
 		else if (outcome == GameState::Drawn) Draws.fetch_add(1, std::memory_order_relaxed);
 		else if (outcome == GameState::BlackVictory) BlackWins.fetch_add(1, std::memory_order_relaxed);
 		
-		// 5. Store the game to the memory, and periodically to the hard drive
-		for (const auto& [fen, whiteScore] : currentGame) {
-			unsavedLines.push_back(ToTextformat(fen, whiteScore, outcome));
-		}
-		if (gamesOnThread % 64 == 0) {
-			std::ofstream file(filename, std::ios_base::app);
-			const std::ostream_iterator<std::string> output_iterator(file, "\n");
-			std::copy(std::begin(unsavedLines), std::end(unsavedLines), output_iterator);
-			file.close();
-			unsavedLines.clear();
-		}
+		// 5. Hand the game over to the writer thread
+		// The positions are only filtered when converting the games, the whole game is needed for replaying
+		startingPosition.Outcome = PackOutcome(outcome);
+		currentGame.push_back(PackedMoveAndScore{});
+		gameBytes.assign(reinterpret_cast<const char*>(&startingPosition), sizeof(PackedPosition));
+		gameBytes.append(reinterpret_cast<const char*>(currentGame.data()), currentGame.size() * sizeof(PackedMoveAndScore));
+		writer.Push(std::move(gameBytes));
 
 		// 6. Update display
-		const int games = Games.load(std::memory_order_relaxed);
 		if (games % 100 == 0) {
 			const auto endTime = Clock::now();
 			const int seconds = static_cast<int>((endTime - StartTime).count() / 1e9);
@@ -310,87 +348,623 @@ void SelfPlay(const std::string filename) {
 				const float drawRate = Draws.load(std::memory_order_relaxed) * 100.f / games;
 				const float blackWinRate = BlackWins.load(std::memory_order_relaxed) * 100.f / games;
 				const float avgPlies = static_cast<float>(Plies.load(std::memory_order_relaxed)) / games;
-				const int searches = Searches.load(std::memory_order_relaxed);
-				const int avgNodes = Nodes.load(std::memory_order_relaxed) / searches;
+				const uint64_t searches = std::max<uint64_t>(Searches.load(std::memory_order_relaxed), 1);
+				const uint64_t avgNodes = Nodes.load(std::memory_order_relaxed) / searches;
 				const float avgDepths = static_cast<float>(Depths.load(std::memory_order_relaxed)) / searches;
 
-				const std::string outcomeString = std::format("Outcomes: {:.1f}% - {:.1f}% - {:.1f}%", whiteWinRate, drawRate, blackWinRate);
-				const std::string lengthString = std::format("Avg. game length: {:.1f} plies", avgPlies);
-				const std::string depthString = std::format("Avg. depth: {:.2f}", avgDepths);
-				const std::string nodesString = std::format("Avg. nodes: {}", avgNodes);
+				std::stringstream outcomeString, lengthString, depthString, nodesString;
+				outcomeString << std::fixed << std::setprecision(1) << "Outcomes: " << whiteWinRate << "% - " << drawRate << "% - " << blackWinRate << "%";
+				lengthString << std::fixed << std::setprecision(1) << "Avg. game length: " << avgPlies << " plies";
+				depthString << std::fixed << std::setprecision(2) << "Avg. depth: " << avgDepths;
+				nodesString << "Avg. nodes: " << avgNodes;
 
-				cout << Console::Gray;
-				cout << std::format(" -> {:32}  -> {:32}\n", outcomeString, lengthString);
-				cout << std::format(" -> {:32}  -> {:32}\n", depthString, nodesString);
-				cout << Console::White << std::flush;
+				cout << Console::Gray << std::left;
+				cout << " -> " << std::setw(32) << outcomeString.str() << "  -> " << std::setw(32) << lengthString.str() << '\n';
+				cout << " -> " << std::setw(32) << depthString.str() << "  -> " << std::setw(32) << nodesString.str() << '\n';
+				cout << std::right << Console::White << std::flush;
 			}
 		}
 
 	}
 }
 
-// File merging tool ------------------------------------------------------------------------------
+// Converting between formats ---------------------------------------------------------------------
 
-static void MergeDatagenFiles() {
-	SetTitle("Renegade's file merging utility for datagen");
-	const std::filesystem::path path = std::filesystem::current_path();
-	cout << "Current folder: " << Console::Yellow << path.string() << Console::White << endl;
+// Opening the output truncates it, so writing into one of the inputs would lose the data before it is read
+static bool IsSameFile(const std::string& first, const std::string& second) {
+	std::error_code error;
+	return std::filesystem::equivalent(first, second, error) && !error;
+}
 
-	std::string name;
-	cout << "\nWhat is the base name of the generated files? " << Console::Yellow;
-	cin >> name;
+// Calls the callback for each position in the file, games are replayed and filtered on the way
+// Returns false if the file can't be opened or has malformed contents
+template <typename Callback>
+static bool ReadTrainingData(const std::string& filename, const TrainingDataFormat format, Callback&& callback) {
+	std::ifstream input(filename, std::ios_base::binary);
+	if (!input.is_open()) return false;
+
+	switch (format) {
+	case TrainingDataFormat::Text: {
+		std::string line, fen;
+		int16_t whiteScore = 0;
+		GameState outcome = GameState::Playing;
+		while (std::getline(input, line)) {
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			if (line.empty()) continue;
+			if (!ParseTextFormat(line, fen, whiteScore, outcome)) return false;
+			callback(Position(fen), whiteScore, outcome);
+		}
+		return true;
+	}
 
-	uint64_t limit = -1;
-	cout << Console::White << "How many positions maximum (-1 for no limit)? " << Console::Yellow;
-	cin >> limit;
+	case TrainingDataFormat::Packed: {
+		PackedPosition packed{};
+		while (input.read(reinterpret_cast<char*>(&packed), sizeof(PackedPosition))) {
+			callback(UnpackPosition(packed), packed.Score, UnpackOutcome(packed.Outcome));
+		}
+		return input.gcount() == 0;
+	}
 
-	// Iterate through files in directory
-	std::vector<std::string> found;
-	for (const auto& entry : std::filesystem::directory_iterator(path)) {
-		auto filename = entry.path().filename();
-		if (filename.string().starts_with(name)) {
-			found.push_back(filename.string());
+	case TrainingDataFormat::Games: {
+		PackedPosition start{};
+		PackedMoveAndScore entry{};
+		while (input.read(reinterpret_cast<char*>(&start), sizeof(PackedPosition))) {
+			Position position = UnpackPosition(start);
+			const GameState outcome = UnpackOutcome(start.Outcome);
+			while (true) {
+				if (!input.read(reinterpret_cast<char*>(&entry), sizeof(PackedMoveAndScore))) return false;
+				if (entry.Move == 0) break;
+				const Move move = Move(entry.Move);
+				if (!position.IsPseudoLegal(move) || !position.IsLegalMove(move)) return false;
+				if (!Filter(position, move, entry.Score)) callback(position, entry.Score, outcome);
+				position.PushMove(move);
+			}
 		}
+		return input.gcount() == 0;
 	}
-	cout << Console::White << "\nFound " << Console::Yellow << found.size() << Console::White << " files\n" << endl;
 
-	// Write file
-	const std::string mergedName = name + "_merged";
-	std::ofstream output;
-	output.open(mergedName, std::ios_base::app);
-	int counter = 0;
+	default:
+		return false;
+	}
+}
 
-	for (const auto& filename : found) {
-		std::ifstream ifs(filename);
-		std::string line;
-		cout << filename << ": ";
+void ConvertTrainingData(const std::string& inputName, const std::string& outputName) {
+	const TrainingDataFormat inputFormat = GetTrainingDataFormat(inputName);
+	const TrainingDataFormat outputFormat = GetTrainingDataFormat(outputName);
+	if (inputFormat == TrainingDataFormat::Unknown || outputFormat == TrainingDataFormat::Unknown) {
+		cout << "Unknown format, the files should end with .txt, .bin or .games" << endl;
+		return;
+	}
+	if (outputFormat == TrainingDataFormat::Games) {
+		cout << "Games can't be restored from individual positions" << endl;
+		return;
+	}
+	if (IsSameFile(inputName, outputName)) {
+		cout << "The output can't be the same file as the input" << endl;
+		return;
+	}
+
+	std::ofstream output(outputName, std::ios_base::binary);
+	if (!output.is_open()) {
+		cout << "Could not open " << outputName << " for writing" << endl;
+		return;
+	}
+
+	const auto startTime = Clock::now();
+	uint64_t positions = 0;
+	const bool success = ReadTrainingData(inputName, inputFormat, [&](const Position& pos, const int16_t whiteScore, const GameState outcome) {
+		if (outputFormat == TrainingDataFormat::Text) {
+			output << ToTextFormat(pos.GetFEN(), whiteScore, outcome) << '\n';
+		}
+		else {
+			const PackedPosition packed = PackPosition(pos, whiteScore, outcome);
+			output.write(reinterpret_cast<const char*>(&packed), sizeof(PackedPosition));
+		}
+		positions += 1;
+	});
+	output.close();
+
+	const int milliseconds = static_cast<int>((Clock::now() - startTime).count() / 1e6);
+	if (!success) cout << "Failed to read " << inputName << " after " << Console::FormatInteger(positions) << " positions" << endl;
+	else cout << "Converted " << Console::FormatInteger(positions) << " positions in " << milliseconds << " ms" << endl;
+}
+
+// Reading memory mapped files --------------------------------------------------------------------
+
+// Splits a mapped file into chunks, packed positions are cut at record boundaries, text at line ends,
+// and games are cut between games (a packed starting position followed by the moves until the null move)
+static std::vector<std::pair<std::size_t, std::size_t>> SplitTrainingData(const MappedFile& file, const TrainingDataFormat format) {
+	std::vector<std::pair<std::size_t, std::size_t>> chunks;
+	const uint8_t* data = file.GetData();
+	if (format == TrainingDataFormat::Games) {
+		const std::size_t size = file.GetSize();
+		std::size_t start = 0, offset = 0;
+		while (offset < size) {
+			offset += sizeof(PackedPosition);
+			while (offset + sizeof(PackedMoveAndScore) <= size) {
+				PackedMoveAndScore entry{};
+				std::memcpy(&entry, data + offset, sizeof(PackedMoveAndScore));
+				offset += sizeof(PackedMoveAndScore);
+				if (entry.Move == 0) break;
+			}
+			offset = std::min(offset, size);
+			if (offset - start >= trainingDataChunkBytes || offset == size) {
+				chunks.push_back({ start, offset });
+				start = offset;
+			}
+		}
+		return chunks;
+	}
+
+	const std::size_t size = (format == TrainingDataFormat::Packed) ? file.GetSize() / sizeof(PackedPosition) * sizeof(PackedPosition) : file.GetSize();
+	for (std::size_t start = 0; start < size;) {
+		std::size_t end = std::min(start + trainingDataChunkBytes, size);
+		if (format == TrainingDataFormat::Text && end < size) {
+			const void* newline = std::memchr(data + end, '\n', size - end);
+			end = (newline != nullptr) ? static_cast<const uint8_t*>(newline) - data + 1 : size;
+		}
+		chunks.push_back({ start, end });
+		start = end;
+	}
+	return chunks;
+}
+
+// Calls the callback for each position in a chunk of a mapped file, returns the number of malformed lines or games
+template <typename Callback>
+static uint64_t ReadTrainingDataChunk(const uint8_t* data, const std::size_t start, const std::size_t end, const TrainingDataFormat format, Callback&& callback) {
+	uint64_t malformed = 0;
+	if (format == TrainingDataFormat::Games) {
+		for (std::size_t offset = start; offset < end;) {
+			if (offset + sizeof(PackedPosition) > end) return malformed + 1; // truncated game
+			PackedPosition packed{};
+			std::memcpy(&packed, data + offset, sizeof(PackedPosition));
+			offset += sizeof(PackedPosition);
+			Position position = UnpackPosition(packed);
+			const GameState outcome = UnpackOutcome(packed.Outcome);
+
+			// After an illegal move the rest of the game is skipped, the chunk boundaries don't depend on replaying it
+			bool valid = true;
+			while (true) {
+				if (offset + sizeof(PackedMoveAndScore) > end) return malformed + 1;
+				PackedMoveAndScore entry{};
+				std::memcpy(&entry, data + offset, sizeof(PackedMoveAndScore));
+				offset += sizeof(PackedMoveAndScore);
+				if (entry.Move == 0) break;
+				if (!valid) continue;
+				const Move move = Move(entry.Move);
+				if (!position.IsPseudoLegal(move) || !position.IsLegalMove(move)) {
+					valid = false;
+					continue;
+				}
+				if (!Filter(position, move, entry.Score)) callback(position, entry.Score, outcome);
+				position.PushMove(move);
+			}
+			if (!valid) malformed += 1;
+		}
+		return malformed;
+	}
+
+	if (format == TrainingDataFormat::Packed) {
+		for (std::size_t offset = start; offset < end; offset += sizeof(PackedPosition)) {
+			PackedPosition packed{};
+			std::memcpy(&packed, data + offset, sizeof(PackedPosition));
+			callback(UnpackPosition(packed), packed.Score, UnpackOutcome(packed.Outcome));
+		}
+		return malformed;
+	}
+
+	std::string line, fen;
+	for (std::size_t offset = start; offset < end;) {
+		const void* newline = std::memchr(data + offset, '\n', end - offset);
+		const std::size_t lineEnd = (newline != nullptr) ? static_cast<const uint8_t*>(newline) - data : end;
+		line.assign(reinterpret_cast<const char*>(data + offset), lineEnd - offset);
+		offset = lineEnd + 1;
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (line.empty()) continue;
+
+		int16_t whiteScore = 0;
+		GameState outcome = GameState::Playing;
+		if (!ParseTextFormat(line, fen, whiteScore, outcome)) {
+			malformed += 1;
+			continue;
+		}
+		callback(Position(fen), whiteScore, outcome);
+	}
+	return malformed;
+}
+
+static void AppendTrainingData(std::string& output, const TrainingDataFormat format, const Position& pos, const int16_t whiteScore, const GameState outcome) {
+	if (format == TrainingDataFormat::Text) {
+		output += ToTextFormat(pos.GetFEN(), whiteScore, outcome);
+		output += '\n';
+	}
+	else {
+		const PackedPosition packed = PackPosition(pos, whiteScore, outcome);
+		output.append(reinterpret_cast<const char*>(&packed), sizeof(PackedPosition));
+	}
+}
 
-		while (std::getline(ifs, line)) {
-			if (limit != -1 && counter >= limit) break;
-			counter += 1;
-			if (counter % 1'000'000 == 0) cout << ".";
+// Rescoring --------------------------------------------------------------------------------------
 
-			// Basic check if the output was okay
-			const int pipeCount = std::ranges::count(line, '|');
-			if (pipeCount != 2) {
-				cout << "\n-> Malformed: '" << line << "'" << endl;
+void RescoreTrainingData(const std::string& inputName, const std::string& outputName, const int nodes, const int threadCount) {
+	const TrainingDataFormat inputFormat = GetTrainingDataFormat(inputName);
+	const TrainingDataFormat outputFormat = GetTrainingDataFormat(outputName);
+	if (inputFormat != TrainingDataFormat::Text && inputFormat != TrainingDataFormat::Packed) {
+		cout << "Rescoring needs a .txt or .bin input (games can be converted to .bin first)" << endl;
+		return;
+	}
+	if (outputFormat != TrainingDataFormat::Text && outputFormat != TrainingDataFormat::Packed) {
+		cout << "Rescoring needs a .txt or .bin output" << endl;
+		return;
+	}
+	if (IsSameFile(inputName, outputName)) {
+		cout << "The output can't be the same file as the input" << endl;
+		return;
+	}
+
+	MappedFile input;
+	if (!input.Open(inputName)) {
+		cout << "Could not open " << inputName << endl;
+		return;
+	}
+	std::ofstream output(outputName, std::ios_base::binary);
+	if (!output.is_open()) {
+		cout << "Could not open " << outputName << " for writing" << endl;
+		return;
+	}
+	const std::vector<std::pair<std::size_t, std::size_t>> chunks = SplitTrainingData(input, inputFormat);
+
+	// Chunks are handed out to threads one by one, and written out in order as soon as they are ready
+	// Threads don't get too far ahead of the writing, so the memory used for pending output stays bounded
+	std::atomic<std::size_t> nextChunk = 0;
+	std::atomic<uint64_t> positions = 0, malformed = 0, mateScores = 0;
+	std::map<std::size_t, std::string> pendingOutput;
+	std::size_t writtenChunks = 0;
+	std::mutex outputMutex;
+	std::condition_variable outputCondVar;
+	const std::size_t maxChunksAhead = static_cast<std::size_t>(threadCount) * 4;
+
+	const auto worker = [&]() {
+		std::unique_ptr<Search> searcher = nullptr;
+		if (nodes != 0) {
+			searcher = std::make_unique<Search>(SearchMode::Synchronous);
+			searcher->TranspositionTable.SetSize(1);
+			searcher->DatagenMode = true;
+		}
+		SearchParams params{};
+		params.nodes = nodes;
+
+		// Every position is searched from a clean state, so that the labels don't depend on which thread got which chunk
+		const auto rescore = [&](const Position& pos) {
+			const int score = [&] {
+				if (nodes == 0) return static_cast<int>(NeuralEvaluate(pos));
+				searcher->ResetState(true);
+				return searcher->SearchSinglethreaded(pos, params).score;
+			}();
+			return (pos.Turn() == Side::White) ? score : -score;
+		};
+
+		std::string chunkOutput;
+		while (true) {
+			const std::size_t chunk = nextChunk.fetch_add(1);
+			if (chunk >= chunks.size()) break;
+			{
+				std::unique_lock<std::mutex> lock(outputMutex);
+				outputCondVar.wait(lock, [&] { return chunk < writtenChunks + maxChunksAhead; });
+			}
+
+			chunkOutput.clear();
+			const auto [start, end] = chunks[chunk];
+			const uint64_t malformedInChunk = ReadTrainingDataChunk(input.GetData(), start, end, inputFormat, [&](const Position& pos, const int16_t, const GameState outcome) {
+				// Mate scores are not used as labels, the same way datagen filters them
+				const int whiteScore = rescore(pos);
+				if (std::abs(whiteScore) > MateThreshold) mateScores.fetch_add(1, std::memory_order_relaxed);
+				else AppendTrainingData(chunkOutput, outputFormat, pos, static_cast<int16_t>(whiteScore), outcome);
+				positions.fetch_add(1, std::memory_order_relaxed);
+			});
+			malformed.fetch_add(malformedInChunk, std::memory_order_relaxed);
+
+			// Write every chunk that is ready in order
+			std::unique_lock<std::mutex> lock(outputMutex);
+			pendingOutput[chunk] = std::move(chunkOutput);
+			while (!pendingOutput.empty() && pendingOutput.begin()->first == writtenChunks) {
+				output << pendingOutput.begin()->second;
+				pendingOutput.erase(pendingOutput.begin());
+				writtenChunks += 1;
 			}
+			lock.unlock();
+			outputCondVar.notify_all();
+		}
+	};
+
+	cout << "Rescoring " << inputName << " with " << ((nodes == 0) ? "static evaluation" : std::to_string(nodes) + " node searches")
+		<< " on " << threadCount << " threads" << endl;
+	const auto startTime = Clock::now();
+	std::vector<std::thread> threads;
+	for (int i = 0; i < threadCount; i++) threads.emplace_back(worker);
+
+	// Report progress while the threads are running
+	const auto report = [&] {
+		const double seconds = std::max((Clock::now() - startTime).count() / 1e9, 0.001);
+		const uint64_t processed = positions.load(std::memory_order_relaxed);
+		cout << "Positions: " << Console::FormatInteger(processed) << " | Speed: "
+			<< Console::FormatInteger(static_cast<uint64_t>(processed / seconds)) << " pos/s" << endl;
+	};
+	while (true) {
+		std::unique_lock<std::mutex> lock(outputMutex);
+		if (outputCondVar.wait_for(lock, std::chrono::seconds(5), [&] { return writtenChunks == chunks.size(); })) break;
+		lock.unlock();
+		report();
+	}
+	for (std::thread& t : threads) t.join();
+	output.close();
+
+	report();
+	if (malformed.load() != 0) cout << "Skipped " << Console::FormatInteger(malformed.load()) << " malformed lines" << endl;
+	if (mateScores.load() != 0) cout << "Skipped " << Console::FormatInteger(mateScores.load()) << " positions with mate scores" << endl;
+}
+
+// Merging, shuffling and deduplicating -----------------------------------------------------------
+
+// An external shuffle in two passes, so that the memory use is bounded regardless of the dataset size:
+// 1. positions from all inputs are packed and distributed into temporary bucket files by their hash
+// 2. each bucket is loaded, deduplicated and shuffled in memory, and appended to the output
+// Identical positions always end up in the same bucket, so deduplicating per bucket is global,
+// and since the hash decides the bucket, concatenating shuffled buckets gives a shuffled dataset
+
+struct MergeRecord {
+	uint64_t Hash = 0;
+	PackedPosition Packed{};
+};
+
+static_assert(sizeof(MergeRecord) == 40);
+
+class MergeBuckets {
+public:
+	MergeBuckets(const std::string& baseName, const std::size_t count) : Sizes(count), Mutexes(count) {
+		for (std::size_t i = 0; i < count; i++) {
+			const std::string name = baseName + ".bucket" + std::to_string(i) + ".tmp";
+			Names.push_back(name);
+			Files.push_back(std::fopen(name.c_str(), "w+b"));
+		}
+	}
+
+	~MergeBuckets() {
+		for (std::size_t i = 0; i < Files.size(); i++) {
+			if (Files[i] != nullptr) std::fclose(Files[i]);
+			std::remove(Names[i].c_str());
+		}
+	}
+
+	bool IsOpen() const {
+		return std::none_of(Files.begin(), Files.end(), [](const std::FILE* f) { return f == nullptr; });
+	}
+
+	std::size_t Count() const {
+		return Files.size();
+	}
+
+	std::size_t GetBucket(const uint64_t hash) const {
+		return static_cast<std::size_t>(hash % Files.size());
+	}
+
+	void Append(const std::size_t bucket, const std::vector<MergeRecord>& records) {
+		const std::lock_guard<std::mutex> lock(Mutexes[bucket]);
+		std::fwrite(records.data(), sizeof(MergeRecord), records.size(), Files[bucket]);
+		Sizes[bucket] += records.size() * sizeof(MergeRecord);
+	}
+
+	uint64_t GetLargestSize() const {
+		return Sizes.empty() ? 0 : *std::max_element(Sizes.begin(), Sizes.end());
+	}
+
+	std::vector<MergeRecord> Load(const std::size_t bucket) {
+		const std::lock_guard<std::mutex> lock(Mutexes[bucket]);
+		std::FILE* file = Files[bucket];
+		std::fflush(file);
+		std::error_code error;
+		const uint64_t size = std::filesystem::file_size(Names[bucket], error);
+		std::vector<MergeRecord> records(error ? 0 : size / sizeof(MergeRecord));
+		std::rewind(file);
+		const std::size_t read = std::fread(records.data(), sizeof(MergeRecord), records.size(), file);
+		records.resize(read);
+
+		// The bucket is no longer needed, free up the disk space right away
+		std::fclose(file);
+		Files[bucket] = nullptr;
+		std::remove(Names[bucket].c_str());
+		return records;
+	}
+
+private:
+	std::vector<std::string> Names;
+	std::vector<std::FILE*> Files;
+	std::vector<uint64_t> Sizes;
+	std::vector<std::mutex> Mutexes;
+};
+
+static std::vector<std::string> CollectMergeInputs(const std::vector<std::string>& names) {
+	// Directories are expanded to the training data files inside them
+	std::vector<std::string> inputs;
+	for (const std::string& name : names) {
+		std::error_code error;
+		if (!std::filesystem::is_directory(name, error)) {
+			inputs.push_back(name);
+			continue;
+		}
+		std::vector<std::string> found;
+		for (const auto& entry : std::filesystem::directory_iterator(name, error)) {
+			const std::string path = entry.path().string();
+			if (entry.is_regular_file() && GetTrainingDataFormat(path) != TrainingDataFormat::Unknown) found.push_back(path);
+		}
+		std::sort(found.begin(), found.end());
+		inputs.insert(inputs.end(), found.begin(), found.end());
+	}
+	return inputs;
+}
+
+void MergeTrainingData(const std::string& outputName, const std::vector<std::string>& inputNames, const int memoryMegabytes, const int threadCount) {
+	const TrainingDataFormat outputFormat = GetTrainingDataFormat(outputName);
+	if (outputFormat != TrainingDataFormat::Text && outputFormat != TrainingDataFormat::Packed) {
+		cout << "Merging needs a .txt or .bin output" << endl;
+		return;
+	}
+
+	// Check the inputs, and estimate the number of positions to decide the bucket count
+	const std::vector<std::string> inputs = CollectMergeInputs(inputNames);
+	uint64_t estimatedPositions = 0;
+	for (const std::string& input : inputs) {
+		std::error_code error;
+		const uint64_t size = std::filesystem::file_size(input, error);
+		if (error) {
+			cout << "Could not open " << input << endl;
+			return;
+		}
+		if (IsSameFile(input, outputName)) {
+			cout << "The output can't be one of the inputs, merge into a new file instead" << endl;
+			return;
+		}
+		switch (GetTrainingDataFormat(input)) {
+		case TrainingDataFormat::Text: estimatedPositions += size / 40; break; // a generous lower bound for the line length
+		case TrainingDataFormat::Packed: estimatedPositions += size / sizeof(PackedPosition); break;
+		case TrainingDataFormat::Games: estimatedPositions += size / sizeof(PackedMoveAndScore); break;
+		default:
+			cout << "Unknown format for " << input << ", the files should end with .txt, .bin or .games" << endl;
+			return;
+		}
+	}
+	if (inputs.empty()) {
+		cout << "No input files" << endl;
+		return;
+	}
 
-			// To do: collect stats and display them
+	// Every thread holds one bucket in memory at a time during the second pass, if the bucket count is capped,
+	// the buckets get larger and fewer threads can shuffle at once (this is decided after the first pass)
+	const uint64_t memoryBytes = static_cast<uint64_t>(memoryMegabytes) * 1024 * 1024;
+	const uint64_t bytesPerThread = memoryBytes / threadCount;
+	const uint64_t bucketCount = std::clamp<uint64_t>(estimatedPositions * sizeof(MergeRecord) / std::max<uint64_t>(bytesPerThread, 1) + 1, 1, maxMergeBuckets);
+
+	// The write buffers of the first pass also count towards the limit
+	const std::size_t bufferRecords = std::clamp<std::size_t>(bytesPerThread / 2 / bucketCount / sizeof(MergeRecord), 16, mergeBufferRecords);
+	MergeBuckets buckets(outputName, bucketCount);
+	if (!buckets.IsOpen()) {
+		cout << "Could not create the temporary bucket files" << endl;
+		return;
+	}
 
-			if (counter % 100 == 0) output << line << endl;
-			else output << line << '\n';
+	cout << "Merging " << inputs.size() << " files into " << outputName << " (" << bucketCount << " buckets, "
+		<< threadCount << " threads)" << endl;
+	const auto startTime = Clock::now();
+	std::atomic<uint64_t> readPositions = 0, writtenPositions = 0, malformed = 0;
+
+	// 1. Distributing positions into the buckets
+	// Every input is split into chunks (whole games for game files), which the threads take one at a time
+	std::vector<MappedFile> mappedInputs(inputs.size());
+	std::vector<std::tuple<std::size_t, std::size_t, std::size_t>> tasks;
+	for (std::size_t i = 0; i < inputs.size(); i++) {
+		const TrainingDataFormat format = GetTrainingDataFormat(inputs[i]);
+		if (!mappedInputs[i].Open(inputs[i])) {
+			std::error_code error;
+			if (std::filesystem::file_size(inputs[i], error) == 0 && !error) continue; // empty file
+			cout << "Could not open " << inputs[i] << endl;
+			return;
+		}
+		for (const auto& [start, end] : SplitTrainingData(mappedInputs[i], format)) tasks.push_back({ i, start, end });
+	}
+
+	std::atomic<std::size_t> nextTask = 0;
+	const auto distribute = [&]() {
+		std::vector<std::vector<MergeRecord>> buffers(bucketCount);
+		const auto add = [&](const Position& pos, const int16_t whiteScore, const GameState outcome) {
+			const std::size_t bucket = buckets.GetBucket(pos.Hash());
+			buffers[bucket].push_back({ pos.Hash(), PackPosition(pos, whiteScore, outcome) });
+			if (buffers[bucket].size() == bufferRecords) {
+				buckets.Append(bucket, buffers[bucket]);
+				buffers[bucket].clear();
+			}
+			readPositions.fetch_add(1, std::memory_order_relaxed);
+		};
+
+		while (true) {
+			const std::size_t task = nextTask.fetch_add(1);
+			if (task >= tasks.size()) break;
+			const auto [input, start, end] = tasks[task];
+			const TrainingDataFormat format = GetTrainingDataFormat(inputs[input]);
+			malformed.fetch_add(ReadTrainingDataChunk(mappedInputs[input].GetData(), start, end, format, add), std::memory_order_relaxed);
 		}
-		if (limit != -1 && counter >= limit) break;
+		for (std::size_t bucket = 0; bucket < bucketCount; bucket++) {
+			if (!buffers[bucket].empty()) buckets.Append(bucket, buffers[bucket]);
+		}
+	};
 
-		ifs.close();
+	std::vector<std::thread> threads;
+	for (int i = 0; i < threadCount; i++) threads.emplace_back(distribute);
+	for (std::thread& t : threads) t.join();
+	threads.clear();
+	mappedInputs.clear();
+
+	const int distributeMs = static_cast<int>((Clock::now() - startTime).count() / 1e6);
+	cout << "Distributed " << Console::FormatInteger(readPositions.load()) << " positions in " << distributeMs << " ms" << endl;
+
+	// 2. Deduplicating and shuffling each bucket
+	// A thread needs the largest bucket and its output buffer in memory, run only as many as the limit allows
+	const uint64_t bytesPerShuffle = buckets.GetLargestSize() + mergeOutputBytes;
+	if (bytesPerShuffle > memoryBytes) {
+		cout << "The largest bucket needs " << bytesPerShuffle / (1024 * 1024) + 1 << " MB, which doesn't fit in the "
+			<< memoryMegabytes << " MB memory limit, increase it to merge this much data" << endl;
+		return;
+	}
 
-		cout << endl;
-		cout << " -> processed: " << Console::FormatInteger(counter) << endl;
+	// The output is only opened now, after every input has been read
+	std::ofstream output(outputName, std::ios_base::binary);
+	if (!output.is_open()) {
+		cout << "Could not open " << outputName << " for writing" << endl;
+		return;
 	}
+	const int shuffleThreads = static_cast<int>(std::min<uint64_t>(memoryBytes / bytesPerShuffle, threadCount));
+	if (shuffleThreads < threadCount) cout << "Shuffling with " << shuffleThreads << " threads to stay within the memory limit" << endl;
+
+	std::atomic<std::size_t> nextBucket = 0;
+	std::mutex outputMutex;
+	const auto shuffle = [&]() {
+		std::mt19937_64 generator(std::random_device{}());
+		std::string bucketOutput;
+		const auto flush = [&]() {
+			const std::lock_guard<std::mutex> lock(outputMutex);
+			output << bucketOutput;
+			bucketOutput.clear();
+		};
 
+		while (true) {
+			const std::size_t bucket = nextBucket.fetch_add(1);
+			if (bucket >= bucketCount) break;
+			std::vector<MergeRecord> records = buckets.Load(bucket);
+
+			// Keep one occurrence of each position (sorting in place, so that no extra buffer is needed)
+			std::sort(records.begin(), records.end(), [](const MergeRecord& a, const MergeRecord& b) { return a.Hash < b.Hash; });
+			const auto last = std::unique(records.begin(), records.end(), [](const MergeRecord& a, const MergeRecord& b) { return a.Hash == b.Hash; });
+			records.erase(last, records.end());
+			std::shuffle(records.begin(), records.end(), generator);
+
+			// Buckets are shuffled independently, so their output may interleave
+			for (const MergeRecord& record : records) {
+				if (outputFormat == TrainingDataFormat::Packed) bucketOutput.append(reinterpret_cast<const char*>(&record.Packed), sizeof(PackedPosition));
+				else AppendTrainingData(bucketOutput, outputFormat, UnpackPosition(record.Packed), record.Packed.Score, UnpackOutcome(record.Packed.Outcome));
+				if (bucketOutput.size() >= mergeOutputBytes) flush();
+			}
+			if (!bucketOutput.empty()) flush();
+			writtenPositions.fetch_add(records.size(), std::memory_order_relaxed);
+		}
+	};
+
+	for (int i = 0; i < shuffleThreads; i++) threads.emplace_back(shuffle);
+	for (std::thread& t : threads) t.join();
 	output.close();
-	cout << Console::Green << "\nCompleted." << Console::White << endl;
-	PressEnterToExit();
+
+	const uint64_t read = readPositions.load(), written = writtenPositions.load();
+	const double seconds = std::max((Clock::now() - startTime).count() / 1e9, 0.001);
+	cout << "Wrote " << Console::FormatInteger(written) << " positions, removed " << Console::FormatInteger(read - written) << " duplicates" << endl;
+	if (malformed.load() != 0) cout << "Skipped " << Console::FormatInteger(malformed.load()) << " malformed lines or games" << endl;
+	cout << "Completed in " << std::fixed << std::setprecision(1) << seconds << std::defaultfloat << " s ("
+		<< Console::FormatInteger(static_cast<uint64_t>(read / seconds)) << " pos/s)" << endl;
 }
-*/
\ No newline at end of file
@@ -1,12 +1,21 @@
-/*#pragma once
+#pragma once
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
 #include <optional>
+#include <random>
+#include <sstream>
 #include <thread>
+#include "MappedFile.h"
 #include "Position.h"
 #include "Search.h"
 #include "Settings.h"
+#include "TrainingData.h"
 #include "Utils.h"
 
 
@@ -25,8 +34,40 @@ constexpr int drawAdjPlies = 15;
 constexpr int winAdjEvalThreshold = 2000;
 constexpr int winAdjEvalPlies = 5;
 
+constexpr int writerQueueGamesPerThread = 16;
+constexpr std::size_t trainingDataChunkBytes = 1 << 20;
+constexpr std::size_t maxMergeBuckets = 512;
+constexpr std::size_t mergeBufferRecords = 1024;
+constexpr std::size_t mergeOutputBytes = 1 << 16;
+
 enum class DatagenLaunchMode { Ask, Normal, DFRC };
 
-void MergeDatagenFiles();
+// Finished games are handed over to a dedicated writer thread through a bounded queue,
+// playing threads only block if the writer falls behind by more than the queue's capacity
+class DatagenWriter {
+public:
+	DatagenWriter(const std::string& filename, const std::size_t capacity);
+	~DatagenWriter();
+	DatagenWriter(const DatagenWriter&) = delete;
+	DatagenWriter& operator=(const DatagenWriter&) = delete;
+
+	bool IsOpen() const;
+	void Push(std::string&& game);
+	void Close();
+
+private:
+	void Loop();
+
+	std::ofstream File;
+	std::deque<std::string> Queue;
+	std::size_t Capacity;
+	std::mutex Mutex;
+	std::condition_variable NotEmpty, NotFull;
+	bool Closing = false;
+	std::thread Thread;
+};
+
+void ConvertTrainingData(const std::string& inputName, const std::string& outputName);
+void RescoreTrainingData(const std::string& inputName, const std::string& outputName, const int nodes, const int threadCount);
+void MergeTrainingData(const std::string& outputName, const std::vector<std::string>& inputNames, const int memoryMegabytes, const int threadCount);
 void StartDatagen(const DatagenLaunchMode launchMode);
-*/
\ No newline at end of file
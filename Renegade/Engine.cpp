@@ -4,7 +4,10 @@ Engine::Engine(int argc, char* argv[]) {
 	Settings::UseUCI = !PrettySupport;
 	SearchThreads.TranspositionTable.SetSize(Settings::Hash);
 
+	for (int i = 1; i < argc; i++) LaunchArguments.push_back(std::string(argv[i]));
+
 	if (argc == 2 && std::string(argv[1]) == "bench") Behavior = EngineBehavior::Bench;
+	else if (argc > 2 && std::string(argv[1]) == "bench") Behavior = EngineBehavior::ExtendedBench;
 	else if (argc == 2 && std::string(argv[1]) == "datagen") Behavior = EngineBehavior::DatagenNormal;
 	else if (argc == 2 && std::string(argv[1]) == "dfrcdatagen") Behavior = EngineBehavior::DatagenDFRC;
 	else PrintHeader();
@@ -24,12 +27,20 @@ void Engine::Start() {
 		return;
 	}
 
+	// Handle externally receiving a bench with arguments, e.g. 'Renegade bench threads 8 hash 64 depth 14'
+	if (Behavior == EngineBehavior::ExtendedBench) {
+		HandleExtendedBench(LaunchArguments);
+		SearchThreads.StopThreads();
+		return;
+	}
+
 	// Handle externally receiving datagen
-	/*if (Behavior == EngineBehavior::DatagenNormal || Behavior == EngineBehavior::DatagenDFRC) {
+	if (Behavior == EngineBehavior::DatagenNormal || Behavior == EngineBehavior::DatagenDFRC) {
 		const DatagenLaunchMode launchMode = (Behavior == EngineBehavior::DatagenNormal) ? DatagenLaunchMode::Normal : DatagenLaunchMode::DFRC;
+		SearchThreads.StopThreads();
 		StartDatagen(launchMode);
 		return;
-	}*/
+	}
 
 	Position position = Position(FEN::StartPos);
 	std::string cmd;
@@ -56,8 +67,11 @@ void Engine::Start() {
 			cout << "option name Clear Hash type button" << '\n';
 			cout << "option name Hash type spin default " << HashDefault << " min " << HashMin << " max " << HashMax << '\n';
 			cout << "option name Threads type spin default " << ThreadsDefault << " min " << ThreadsMin << " max " << ThreadsMax << '\n';
+			cout << "option name MultiPV type spin default " << MultiPVDefault << " min " << MultiPVMin << " max " << MultiPVMax << '\n';
+			cout << "option name Ponder type check default false" << '\n';
 			cout << "option name UCI_ShowWDL type check default " << (ShowWDLDefault ? "true" : "false") << '\n';
 			cout << "option name UCI_Chess960 type check default " << (Chess960Default ? "true" : "false") << '\n';
+			cout << "option name SharedNetwork type string default <empty>" << '\n';
 			if (Tune::Active()) Tune::PrintOptions();
 			cout << "uciok" << endl;
 			Settings::UseUCI = true;
@@ -75,22 +89,23 @@ void Engine::Start() {
 			continue;
 		}
 
+		if (cmd == "ponderhit") {
+			SearchThreads.PonderHit();
+			continue;
+		}
+
 		if (cmd == "stop" || cmd == "s") {
 			SearchThreads.StopSearch();
 			SearchThreads.WaitUntilReady();
 			continue;
 		}
 
-		/*
 		if (cmd == "datagen") {
+			SearchThreads.StopThreads();
 			StartDatagen(DatagenLaunchMode::Ask);
 			return;
 		}
 
-		if (cmd == "merge") {
-			MergeDatagenFiles();
-			return;
-		}*/
 
 		if (cmd == "tunetext") {
 			Tune::GenerateString();
@@ -142,6 +157,22 @@ void Engine::Start() {
 				SearchThreads.SetThreadCount(Settings::Threads);
 				valid = true;
 			}
+			else if (parts[2] == "ponder") {
+				// Pondering is controlled by the GUI via 'go ponder', the option only tells it that it's supported
+				valid = true;
+			}
+			else if (parts[2] == "multipv") {
+				Settings::MultiPV = std::clamp(stoi(parts[4]), MultiPVMin, MultiPVMax);
+				valid = true;
+			}
+			else if (parts[2] == "sharednetwork") {
+				// The path may contain spaces, everything after 'value' belongs to it
+				std::string path;
+				for (std::size_t i = 4; i < parts.size(); i++) path += (i == 4 ? "" : " ") + parts[i];
+				if (path == "<empty>") path.clear();
+				UseSharedNetwork(path);
+				valid = true;
+			}
 			else if (Tune::List.find(parts[2]) != Tune::List.end()) {
 				Tune::List.at(parts[2]).value = stoi(parts[4]);
 				valid = true;
@@ -173,6 +204,7 @@ void Engine::Start() {
 			if (parts[1] == "settings") {
 				cout << std::boolalpha;
 				cout << "Hash:      " << Settings::Hash << endl;
+				cout << "MultiPV:   " << Settings::MultiPV << endl;
 				cout << "Show WDL:  " << Settings::ShowWDL << endl;
 				cout << "Chess960:  " << Settings::Chess960 << endl;
 				cout << "Using UCI: " << Settings::UseUCI << endl;
@@ -194,6 +226,20 @@ void Engine::Start() {
 			if (parts[1] == "isdraw") {
 				cout << "Is drawn? " << position.IsDrawn(true) << endl;
 			}
+			if (parts[1] == "fuzz") {
+				HandlePseudolegalFuzz(parts.size() > 2 ? std::stoi(parts[2]) : 100);
+			}
+			if (parts[1] == "stats") {
+				if (!StatisticsEnabled) {
+					cout << "Search statistics are not collected in this build (compile with 'make stats=1')" << endl;
+					continue;
+				}
+				const SearchStatistics stats = SearchThreads.GetLastStatistics();
+				cout << "Search statistics of the last search:" << endl;
+				for (int i = 0; i < SearchStatCount; i++) {
+					cout << "- " << std::left << std::setw(24) << SearchStatNames[i] << std::right << Console::FormatInteger(stats.Counts[i]) << endl;
+				}
+			}
 			continue;
 		}
 
@@ -202,6 +248,37 @@ void Engine::Start() {
 			HandleHelp();
 			continue;
 		}
+		if (parts[0] == "convert" && parts.size() == 3) {
+			ConvertTrainingData(parts[1], parts[2]);
+			continue;
+		}
+		if (parts[0] == "rescore" && parts.size() >= 3) {
+			int nodes = 0;
+			int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+			for (std::size_t i = 3; i + 1 < parts.size(); i += 2) {
+				if (parts[i] == "nodes") nodes = std::max(stoi(parts[i + 1]), 0);
+				else if (parts[i] == "threads") threads = std::max(stoi(parts[i + 1]), 1);
+			}
+			RescoreTrainingData(parts[1], parts[2], nodes, threads);
+			continue;
+		}
+		if (parts[0] == "merge" && parts.size() >= 3) {
+			std::vector<std::string> inputs;
+			int memory = 1024;
+			int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+			for (std::size_t i = 2; i < parts.size(); i++) {
+				if (parts[i] == "memory" && i + 1 < parts.size()) memory = std::max(stoi(parts[++i]), 1);
+				else if (parts[i] == "threads" && i + 1 < parts.size()) threads = std::max(stoi(parts[++i]), 1);
+				else inputs.push_back(parts[i]);
+			}
+			MergeTrainingData(parts[1], inputs, memory, threads);
+			continue;
+		}
+		if (parts[0] == "analyse" || parts[0] == "analyze") {
+			AnalysisParams analysisParams;
+			if (ParseAnalysisParams(parts, analysisParams)) RunAnalysis(analysisParams);
+			continue;
+		}
 		if (parts[0] == "draw" || parts[0] == "d") {
 			DrawBoard(position);
 			continue;
@@ -313,14 +390,16 @@ void Engine::Start() {
 			}
 			if (SearchThread.joinable()) SearchThread.join();*/
 
-			if ((parts.size() == 3) && (parts[1] == "perft" || parts[1] == "perftdiv")) {
+			if ((parts.size() == 3 || (parts.size() == 5 && parts[3] == "tt")) && (parts[1] == "perft" || parts[1] == "perftdiv")) {
 				const int depth = stoi(parts[2]);
+				const int hashMegabytes = (parts.size() == 5) ? stoi(parts[4]) : 0;
 				const PerftType type = (parts[1] == "perftdiv") ? PerftType::PerftDiv : PerftType::Normal;
-				SearchThreads.Perft(position, depth, type);
+				SearchThreads.Perft(position, depth, type, hashMegabytes);
 				continue;
 			}
 
 			params = SearchParams();
+			params.multiPV = Settings::MultiPV;
 			for (int i = 1; i < parts.size(); i++) {
 				// This looks ugly, but I'll rewrite it
 				if (parts[i] == "wtime") { 
@@ -339,9 +418,22 @@ void Engine::Start() {
 				if (parts[i] == "nodes") { params.nodes = stoi(parts[i + 1]); i++; }
 				if (parts[i] == "softnodes") { params.softnodes = stoi(parts[i + 1]); i++; }
 				if (parts[i] == "depth") { params.depth = stoi(parts[i + 1]); i++; }
-				if (parts[i] == "mate") { params.depth = stoi(parts[i + 1]); i++; } // To do: search for mates only
+				if (parts[i] == "mate") { params.mate = stoi(parts[i + 1]); i++; }
 				if (parts[i] == "movetime") { params.movetime = stoi(parts[i + 1]); i++; }
-				if (parts[i] == "searchmoves") { cout << "info string Searchmoves parameter is not yet implemented!" << endl; }
+				if (parts[i] == "infinite") { params.infinite = true; }
+				if (parts[i] == "ponder") { params.ponder = true; }
+				if (parts[i] == "searchmoves") {
+					// The list of moves ends at the first token that isn't a legal move
+					MoveList legalMoves{};
+					position.GenerateMoves(legalMoves, MoveGen::All, Legality::Legal);
+					while (i + 1 < parts.size()) {
+						const auto it = std::find_if(legalMoves.begin(), legalMoves.end(),
+							[&](const ScoredMove& m) { return m.move.ToString(Settings::Chess960) == parts[i + 1]; });
+						if (it == legalMoves.end()) break;
+						params.searchmoves.push_back(it->move.Pack());
+						i++;
+					}
+				}
 			}
 
 			// Starting the search thread
@@ -350,7 +442,17 @@ void Engine::Start() {
 		}
 
 		if (parts[0] == "bench" || parts[0] == "b") {
-			HandleBench();
+			if (parts.size() == 1) {
+				HandleBench();
+				continue;
+			}
+			HandleExtendedBench(parts);
+			continue;
+		}
+
+		if (parts[0] == "benchmovegen") {
+			std::vector<std::string> fens{};
+			if (LoadMovegenBenchFENs(parts, fens)) RunMovegenBench(fens);
 			continue;
 		}
 
@@ -504,6 +606,7 @@ void Engine::HandleBench() {
 	uint64_t nodes = 0;
 	SearchParams params{};
 	params.depth = 14;
+	if constexpr (ProfilerEnabled) Profiler::Reset();
 	const auto startTime = Clock::now();
 
 	for (std::string fen : BenchmarkFENs) {
@@ -519,6 +622,7 @@ void Engine::HandleBench() {
 	const auto endTime = Clock::now();
 	const int nps = static_cast<int>(nodes / ((endTime - startTime).count() / 1e9));
 	cout << nodes << " nodes " << nps << " nps" << endl;
+	if constexpr (ProfilerEnabled) Profiler::PrintBreakdown(1, false);
 
 	SearchThreads.ResetState(false);
 	Settings::Hash = oldHashSize;
@@ -530,6 +634,77 @@ void Engine::HandleBench() {
 	Settings::Chess960 = oldChess960Setting;
 }
 
+void Engine::HandleExtendedBench(const std::vector<std::string>& parts) {
+	if (parts.size() >= 2 && parts[1] == "report") {
+		BenchReportParams reportParams;
+		if (ParseBenchReportParams(parts, reportParams)) RunBenchReport(SearchThreads, reportParams);
+	}
+	else {
+		ScalingBenchParams scalingParams;
+		if (ParseScalingBenchParams(parts, scalingParams)) RunScalingBench(SearchThreads, scalingParams);
+	}
+}
+
+void Engine::HandlePseudolegalFuzz(const int games) const {
+	// Compares Position::IsPseudoLegal against move generation in positions of random games
+	// Besides the generated moves, it checks moves from other positions (like stale TT moves) and random moves
+	const bool oldChess960Setting = Settings::Chess960;
+	std::mt19937 generator(20240501);
+	std::vector<Move> seenMoves{};
+	uint64_t positions = 0, checks = 0, mismatches = 0;
+
+	const auto contains = [](const MoveList& moves, const Move& move) {
+		return std::any_of(moves.begin(), moves.end(), [&](const ScoredMove& m) { return m.move == move; });
+	};
+
+	for (int game = 0; game < games; game++) {
+		std::string fen = BenchmarkFENs[game % BenchmarkFENs.size()];
+		Settings::Chess960 = StartsWith(fen, "[frc]");
+		if (StartsWith(fen, "[frc]")) fen = fen.substr(6, fen.length() - 6);
+		Position pos = Position(fen);
+
+		for (int ply = 0; ply < 300; ply++) {
+			MoveList all{}, noisy{}, quiet{};
+			pos.GenerateMoves(all, MoveGen::All, Legality::Pseudolegal);
+			pos.GenerateMoves(noisy, MoveGen::Noisy, Legality::Pseudolegal);
+			pos.GenerateMoves(quiet, MoveGen::Quiet, Legality::Pseudolegal);
+			positions += 1;
+
+			const auto check = [&](const Move& m) {
+				const std::array<std::pair<MoveGen, const MoveList*>, 3> scopes = {
+					std::pair{ MoveGen::All, &all }, std::pair{ MoveGen::Noisy, &noisy }, std::pair{ MoveGen::Quiet, &quiet }
+				};
+				for (const auto& [moveGen, moves] : scopes) {
+					checks += 1;
+					const bool expected = contains(*moves, m);
+					if (pos.IsPseudoLegal(m, moveGen) == expected) continue;
+					mismatches += 1;
+					if (mismatches <= 10) cout << "Mismatch: " << pos.GetFEN() << " move " << m.ToString(Settings::Chess960)
+						<< " (flag " << static_cast<int>(m.flag) << ") expected " << expected << endl;
+				}
+			};
+
+			for (const auto& m : all) {
+				check(m.move);
+				if (seenMoves.size() < 100000) seenMoves.push_back(m.move);
+				else seenMoves[generator() % seenMoves.size()] = m.move;
+			}
+			for (int i = 0; i < 32; i++) check(seenMoves[generator() % seenMoves.size()]);
+			for (int i = 0; i < 32; i++) check(Move(static_cast<uint16_t>(generator() & 0xFFFF)));
+
+			// Continue the game with a random legal move
+			MoveList legalMoves{};
+			pos.GenerateMoves(legalMoves, MoveGen::All, Legality::Legal);
+			if (legalMoves.size() == 0 || pos.IsDrawn(false)) break;
+			pos.PushMove(legalMoves[generator() % legalMoves.size()].move);
+		}
+	}
+
+	Settings::Chess960 = oldChess960Setting;
+	cout << "Pseudolegality fuzzing: " << Console::FormatInteger(positions) << " positions, " << Console::FormatInteger(checks)
+		<< " checks, " << mismatches << " mismatches" << endl;
+}
+
 void Engine::HandleCompiler() const {
 #if defined(__clang__)
 	cout << "-> Compiler: clang" << endl;
@@ -543,6 +718,7 @@ void Engine::HandleCompiler() const {
 #elif
 	cout << "-> Unknown - Interesting compiler you've got there!" << endl;
 #endif
+	cout << "-> Slider attacks: " << GetSliderBackendName() << endl;
 }
 
 void Engine::HandleHelp() const {
@@ -554,5 +730,20 @@ void Engine::HandleHelp() const {
 		<< "\n- draw: draws the current board"
 		<< "\n- eval: prints the static evaluation of the position"
 		<< "\n- fen: displays the current position's FEN string"
-		<< "\n- go perft [n] & go perftdiv [n]: retuns the number of possible positions after n plys (incl. duplicates)\n" << endl;
+		<< "\n- bench threads [n] hash [mb] depth [d] (or movetime [ms]): measures search scaling with 1, 2, 4, ..., n threads"
+		<< "\n- bench report [file] depth [d]: writes per-position bench results to a file (CSV for .csv, JSON lines otherwise)"
+		<< "\n- benchmovegen [file]: measures move generation primitives in ns/op (on the bench positions, or FENs from a file)"
+		<< "\n- analyse [file] output [file] depth [d] (or nodes [n], movetime [ms]) threads [t] hash [mb] multipv [n]: analyses each"
+		<< "\n  position of an EPD file independently, the results are written as JSON lines (to the console by default)"
+		<< "\n- datagen: generates self-play training data (asks for the settings, exits afterwards)"
+		<< "\n- convert [input] [output]: converts training data, the format is given by the extension"
+		<< "\n  (.txt: text, .bin: 32-byte packed positions, .games: datagen output, use 'frc on' for DFRC data)"
+		<< "\n- rescore [input] [output] nodes [n] threads [t]: replaces the scores of .txt or .bin training data"
+		<< "\n  with the static evaluation, or with the result of an n node search if given"
+		<< "\n- merge [output] [inputs...] memory [MB] threads [t]: merges, deduplicates and shuffles training data"
+		<< "\n  (inputs can be files or directories, the memory use stays around the given limit)"
+		<< "\n- debug fuzz [games]: checks pseudolegality detection against move generation in random games"
+		<< "\n- debug stats: shows search statistics of the last search (requires compiling with stats=1)"
+		<< "\n- go perft [n] & go perftdiv [n]: retuns the number of possible positions after n plys (incl. duplicates)"
+		<< "\n  (uses all search threads, append 'tt [MB]' to use a hash table of that size)\n" << endl;
 }
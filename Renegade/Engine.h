@@ -1,4 +1,6 @@
 #pragma once
+#include "Analysis.h"
+#include "Benchmark.h"
 #include "Datagen.h"
 #include "Magics.h"
 #include "Neural.h"
@@ -12,9 +14,9 @@
 #include <thread>
 #include <tuple>
 
-void GenerateMagicTables();
+void InitializeSliderAttacks();
 
-enum class EngineBehavior { Normal, Bench, DatagenNormal, DatagenDFRC };
+enum class EngineBehavior { Normal, Bench, ExtendedBench, DatagenNormal, DatagenDFRC };
 
 class Engine
 {
@@ -24,11 +26,14 @@ public:
 	void PrintHeader() const;
 	void DrawBoard(const Position &pos, const uint64_t highlight = 0) const;
 	void HandleBench();
+	void HandleExtendedBench(const std::vector<std::string>& parts);
+	void HandlePseudolegalFuzz(const int games) const;
 	void HandleHelp() const;
 	void HandleCompiler() const;
 
 	Search SearchThreads;
 	EngineBehavior Behavior = EngineBehavior::Normal;
+	std::vector<std::string> LaunchArguments;
 
 #if defined(_MSC_VER)
 	const bool PrettySupport = true;
@@ -3,32 +3,22 @@
 // Largely based on https://github.com/maksimKorzh/chess_programming/blob/master/src/magics/magics.c
 // and indirectly on https://www.chessprogramming.org/Looking_for_Magics#Feeding_in_Randoms
 
-// Retrieving attack bitboards --------------------------------------------------------------------
-
-uint64_t GetRookAttacks(const uint8_t square, const uint64_t occupancy) {
-	const int index = static_cast<int>(((occupancy & RookMasks[square]) * RookMagicNumbers[square]) >> (64 - RookRelevantBits[square]));
-	return RookAttacks[square][index];
-}
-
-uint64_t GetBishopAttacks(const uint8_t square, const uint64_t occupancy) {
-	const int index = static_cast<int>(((occupancy & BishopMasks[square]) * BishopMagicNumbers[square]) >> (64 - BishopRelevantBits[square]));
-	return BishopAttacks[square][index];
-}
-
-uint64_t GetQueenAttacks(const uint8_t square, const uint64_t occupancy) {
-	const int rookIndex = static_cast<int>(((occupancy & RookMasks[square]) * RookMagicNumbers[square]) >> (64 - RookRelevantBits[square]));
-	const int bishopIndex = static_cast<int>(((occupancy & BishopMasks[square]) * BishopMagicNumbers[square]) >> (64 - BishopRelevantBits[square]));
-	return BishopAttacks[square][bishopIndex] | RookAttacks[square][rookIndex];
-}
-
-uint64_t GetConnectingRay(const uint8_t from, const uint64_t to) {
-	return ConnectingRays[from][to];
-}
-
-// Things for lookup table population -------------------------------------------------------------
+#if defined(__x86_64__) || defined(_M_X64)
+#define RENEGADE_PEXT_SUPPORTED
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define RENEGADE_TARGET_BMI2
+#else
+#include <cpuid.h>
+#include <immintrin.h>
+#define RENEGADE_TARGET_BMI2 __attribute__((target("bmi2")))
+#endif
+#endif
+
+// Reference attack generation -------------------------------------------------------------------
 
 // Generate an occupancy bitboard where the encoded bits represent occupied bits in the mask
-uint64_t GenerateMagicOccupancy(const int encoded, uint64_t mask) {
+static constexpr uint64_t GenerateMagicOccupancy(const int encoded, uint64_t mask) {
 	uint64_t map = 0;
 	const int popcount = Popcount(mask);
 	int i = popcount - 1;
@@ -42,7 +32,7 @@ uint64_t GenerateMagicOccupancy(const int encoded, uint64_t mask) {
 }
 
 // Dynamically generate rook attacks
-uint64_t DynamicRookAttacks(const int square, const uint64_t blockers) {
+static constexpr uint64_t DynamicRookAttacks(const int square, const uint64_t blockers) {
 	uint64_t mask = 0;
 	const int file = GetSquareFile(square);
 	const int rank = GetSquareRank(square);
@@ -68,7 +58,7 @@ uint64_t DynamicRookAttacks(const int square, const uint64_t blockers) {
 }
 
 // Dynamically generate bishop attacks
-uint64_t DynamicBishopAttacks(const int square, const uint64_t blockers) {
+static constexpr uint64_t DynamicBishopAttacks(const int square, const uint64_t blockers) {
 	uint64_t mask = 0;
 	const int file = GetSquareFile(square);
 	const int rank = GetSquareRank(square);
@@ -105,40 +95,76 @@ uint64_t DynamicBishopAttacks(const int square, const uint64_t blockers) {
 	return mask;
 }
 
-void GenerateMagicTables() {
+// Attack lookup tables (generated at compile time) -----------------------------------------------
+
+// The tables are constant, so they are placed in read-only memory, which is shared between engine processes
+// and doesn't need any work at startup (generating them needs a raised constexpr step limit for some compilers)
 
-	// 1. Populate rook magic results
+// Each square only gets as many entries as its relevant occupancy bits require, and the squares are packed
+// after each other: this takes 800 kB for rooks and 41 kB for bishops, instead of 2 MB and 256 kB
+static constexpr std::array<int, 65> CalculateTableOffsets(const std::array<int, 64>& relevantBits) {
+	std::array<int, 65> offsets{};
+	for (int sq = 0; sq < 64; sq++) offsets[sq + 1] = offsets[sq] + (1 << relevantBits[sq]);
+	return offsets;
+}
+
+static constexpr std::array<int, 65> RookTableOffsets = CalculateTableOffsets(RookRelevantBits);
+static constexpr std::array<int, 65> BishopTableOffsets = CalculateTableOffsets(BishopRelevantBits);
+static_assert(RookTableOffsets[64] == 102400 && BishopTableOffsets[64] == 5248);
+
+// Pext tables: the i-th entry of a square belongs to the i-th subset of the square's mask
+// The subsets are enumerated in this order by the carry-rippler trick, occ = (occ - mask) & mask
+template <bool rook, std::size_t size>
+static constexpr std::array<uint64_t, size> GeneratePextTable() {
+	std::array<uint64_t, size> table{};
 	for (int sq = 0; sq < 64; sq++) {
-		for (int i = 0; i < 4096; i++) {
-			const uint64_t occ = GenerateMagicOccupancy(i, RookMasks[sq]);
-			const int index = static_cast<int>((occ * RookMagicNumbers[sq]) >> (64 - RookRelevantBits[sq]));
-			RookAttacks[sq][index] = DynamicRookAttacks(sq, occ);
-		}
+		const uint64_t mask = rook ? RookMasks[sq] : BishopMasks[sq];
+		int index = rook ? RookTableOffsets[sq] : BishopTableOffsets[sq];
+		uint64_t occ = 0;
+		do {
+			table[index] = rook ? DynamicRookAttacks(sq, occ) : DynamicBishopAttacks(sq, occ);
+			index += 1;
+			occ = (occ - mask) & mask;
+		} while (occ != 0);
 	}
+	return table;
+}
 
-	// 2. Populate bishop magic results
+// Magic tables: the same entries as in the pext tables, moved to the index given by the magic multiplication
+template <bool rook, std::size_t size>
+static constexpr std::array<uint64_t, size> GenerateMagicTable(const std::array<uint64_t, size>& pextTable) {
+	std::array<uint64_t, size> table{};
 	for (int sq = 0; sq < 64; sq++) {
-		for (int i = 0; i < 512; i++) {
-			const uint64_t occ = GenerateMagicOccupancy(i, BishopMasks[sq]);
-			const int index = static_cast<int>((occ * BishopMagicNumbers[sq]) >> (64 - BishopRelevantBits[sq]));
-			BishopAttacks[sq][index] = DynamicBishopAttacks(sq, occ);
-		}
+		const uint64_t mask = rook ? RookMasks[sq] : BishopMasks[sq];
+		const uint64_t magic = rook ? RookMagicNumbers[sq] : BishopMagicNumbers[sq];
+		const int shift = 64 - (rook ? RookRelevantBits[sq] : BishopRelevantBits[sq]);
+		const int offset = rook ? RookTableOffsets[sq] : BishopTableOffsets[sq];
+		int index = offset;
+		uint64_t occ = 0;
+		do {
+			table[offset + static_cast<int>((occ * magic) >> shift)] = pextTable[index];
+			index += 1;
+			occ = (occ - mask) & mask;
+		} while (occ != 0);
 	}
+	return table;
+}
 
-	// 3. Generate connecting rays (this is not magic, but for now it's an alright place for this)
-	//    note: the rays include the from and to squares
+// Connecting rays between squares on the same line, including the from and to squares
+static constexpr MultiArray<uint64_t, 64, 64> GenerateConnectingRays() {
+	MultiArray<uint64_t, 64, 64> rays{};
 	for (int i = 0; i < 64; i++) {
 		for (int j = 0; j < 64; j++) {
-			ConnectingRays[i][j] = [&] {
+			rays[i][j] = [&] {
 				if (i == j) return SquareBit(i);
 				if (GetSquareFile(i) == GetSquareFile(j) || GetSquareRank(i) == GetSquareRank(j)) {
-					const uint64_t ray1 = GetRookAttacks(i, SquareBit(j));
-					const uint64_t ray2 = GetRookAttacks(j, SquareBit(i));
+					const uint64_t ray1 = DynamicRookAttacks(i, SquareBit(j));
+					const uint64_t ray2 = DynamicRookAttacks(j, SquareBit(i));
 					return ray1 & ray2 | SquareBit(i) | SquareBit(j);
 				}
 				else if (std::abs(GetSquareFile(i) - GetSquareFile(j)) == std::abs(GetSquareRank(i) - GetSquareRank(j))) {
-					const uint64_t ray1 = GetBishopAttacks(i, SquareBit(j));
-					const uint64_t ray2 = GetBishopAttacks(j, SquareBit(i));
+					const uint64_t ray1 = DynamicBishopAttacks(i, SquareBit(j));
+					const uint64_t ray2 = DynamicBishopAttacks(j, SquareBit(i));
 					const uint64_t ends = (ray1 & ray2) ? SquareBit(i) | SquareBit(j) : 0ull;
 					return ray1 & ray2 | ends;
 				}
@@ -146,6 +172,138 @@ void GenerateMagicTables() {
 			}();
 		}
 	}
+	return rays;
+}
+
+static constexpr std::array<uint64_t, RookTableOffsets[64]> RookPextAttacks = GeneratePextTable<true, RookTableOffsets[64]>();
+static constexpr std::array<uint64_t, BishopTableOffsets[64]> BishopPextAttacks = GeneratePextTable<false, BishopTableOffsets[64]>();
+static constexpr std::array<uint64_t, RookTableOffsets[64]> RookAttacks = GenerateMagicTable<true>(RookPextAttacks);
+static constexpr std::array<uint64_t, BishopTableOffsets[64]> BishopAttacks = GenerateMagicTable<false>(BishopPextAttacks);
+static constexpr MultiArray<uint64_t, 64, 64> ConnectingRays = GenerateConnectingRays();
+static SliderBackend ActiveSliderBackend = SliderBackend::Magic;
+
+// Retrieving attack bitboards --------------------------------------------------------------------
+
+#if defined(RENEGADE_PEXT_SUPPORTED)
+RENEGADE_TARGET_BMI2 static uint64_t GetPextRookAttacks(const uint8_t square, const uint64_t occupancy) {
+	return RookPextAttacks[RookTableOffsets[square] + _pext_u64(occupancy, RookMasks[square])];
+}
+
+RENEGADE_TARGET_BMI2 static uint64_t GetPextBishopAttacks(const uint8_t square, const uint64_t occupancy) {
+	return BishopPextAttacks[BishopTableOffsets[square] + _pext_u64(occupancy, BishopMasks[square])];
+}
+#endif
+
+static uint64_t GetMagicRookAttacks(const uint8_t square, const uint64_t occupancy) {
+	const int index = static_cast<int>(((occupancy & RookMasks[square]) * RookMagicNumbers[square]) >> (64 - RookRelevantBits[square]));
+	return RookAttacks[RookTableOffsets[square] + index];
+}
+
+static uint64_t GetMagicBishopAttacks(const uint8_t square, const uint64_t occupancy) {
+	const int index = static_cast<int>(((occupancy & BishopMasks[square]) * BishopMagicNumbers[square]) >> (64 - BishopRelevantBits[square]));
+	return BishopAttacks[BishopTableOffsets[square] + index];
+}
+
+uint64_t GetRookAttacks(const uint8_t square, const uint64_t occupancy) {
+#if defined(RENEGADE_PEXT_SUPPORTED)
+	if (ActiveSliderBackend == SliderBackend::Pext) return GetPextRookAttacks(square, occupancy);
+#endif
+	return GetMagicRookAttacks(square, occupancy);
+}
+
+uint64_t GetBishopAttacks(const uint8_t square, const uint64_t occupancy) {
+#if defined(RENEGADE_PEXT_SUPPORTED)
+	if (ActiveSliderBackend == SliderBackend::Pext) return GetPextBishopAttacks(square, occupancy);
+#endif
+	return GetMagicBishopAttacks(square, occupancy);
+}
+
+uint64_t GetQueenAttacks(const uint8_t square, const uint64_t occupancy) {
+	return GetRookAttacks(square, occupancy) | GetBishopAttacks(square, occupancy);
+}
+
+uint64_t GetConnectingRay(const uint8_t from, const uint64_t to) {
+	return ConnectingRays[from][to];
+}
+
+SliderBackend GetSliderBackend() {
+	return ActiveSliderBackend;
+}
+
+const char* GetSliderBackendName() {
+	return (ActiveSliderBackend == SliderBackend::Pext) ? "pext" : "magic";
+}
+
+// Selecting the backend --------------------------------------------------------------------------
+
+static bool IsPextSupported() {
+#if defined(RENEGADE_PEXT_SUPPORTED)
+#if defined(_MSC_VER) && !defined(__clang__)
+	int registers[4]{};
+	__cpuid(registers, 0);
+	if (registers[0] < 7) return false;
+	__cpuidex(registers, 7, 0);
+	return (registers[1] >> 8) & 1;
+#else
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+	return (ebx >> 8) & 1;
+#endif
+#else
+	return false;
+#endif
+}
+
+static bool IsPextFast() {
+	// Pext is fast on every Intel CPU supporting it, and on AMD since Zen 3 (family 19h)
+	// Older AMD CPUs with BMI2 (Excavator, Zen 1 and 2, families 15h-17h) take up to hundreds of cycles
+#if defined(RENEGADE_PEXT_SUPPORTED)
+	std::array<unsigned int, 4> vendor{}, signature{};
+#if defined(_MSC_VER) && !defined(__clang__)
+	__cpuid(reinterpret_cast<int*>(vendor.data()), 0);
+	__cpuid(reinterpret_cast<int*>(signature.data()), 1);
+#else
+	__get_cpuid(0, &vendor[0], &vendor[1], &vendor[2], &vendor[3]);
+	__get_cpuid(1, &signature[0], &signature[1], &signature[2], &signature[3]);
+#endif
+	const bool amd = vendor[1] == 0x68747541 && vendor[3] == 0x69746e65 && vendor[2] == 0x444d4163; // "AuthenticAMD"
+	if (!amd) return true;
+	const unsigned int baseFamily = (signature[0] >> 8) & 0xF;
+	const unsigned int family = (baseFamily == 0xF) ? baseFamily + ((signature[0] >> 20) & 0xFF) : baseFamily;
+	return family >= 0x19;
+#else
+	return false;
+#endif
+}
+
+#if !defined(NDEBUG)
+// Compare both backends against each other and the reference implementation for every relevant occupancy
+static void VerifySliderBackends() {
+	if (!IsPextSupported()) return;
+	int mismatches = 0;
+	for (int sq = 0; sq < 64; sq++) {
+		for (int i = 0; i < (1 << RookRelevantBits[sq]); i++) {
+			const uint64_t occ = GenerateMagicOccupancy(i, RookMasks[sq]);
+			const uint64_t expected = DynamicRookAttacks(sq, occ);
+			if (GetMagicRookAttacks(sq, occ) != expected || GetPextRookAttacks(sq, occ) != expected) mismatches += 1;
+		}
+		for (int i = 0; i < (1 << BishopRelevantBits[sq]); i++) {
+			const uint64_t occ = GenerateMagicOccupancy(i, BishopMasks[sq]);
+			const uint64_t expected = DynamicBishopAttacks(sq, occ);
+			if (GetMagicBishopAttacks(sq, occ) != expected || GetPextBishopAttacks(sq, occ) != expected) mismatches += 1;
+		}
+	}
+	if (mismatches != 0) cout << "info string Slider attack backends disagree in " << mismatches << " cases!" << endl;
+	assert(mismatches == 0);
+}
+#endif
+
+void InitializeSliderAttacks() {
+	// The tables are generated at compile time, only the lookup method needs to be selected
+#if defined(RENEGADE_PEXT_SUPPORTED) && !defined(NDEBUG)
+	VerifySliderBackends();
+#endif
+	ActiveSliderBackend = (IsPextSupported() && IsPextFast()) ? SliderBackend::Pext : SliderBackend::Magic;
 }
 
 // Magic number generation (not actively needed) --------------------------------------------------
@@ -2,18 +2,19 @@
 #include <random>
 #include "Utils.h"
 
+// Slider attack lookups can use magic multiplication or the pext instruction (BMI2), chosen at runtime
+// Pext is only used if the CPU is known to execute it fast: Zen 2 and earlier implement it in microcode
+enum class SliderBackend { Magic, Pext };
+
 // Methods:
-extern void GenerateMagicTables();
+extern void InitializeSliderAttacks();
+extern SliderBackend GetSliderBackend();
+extern const char* GetSliderBackendName();
 extern uint64_t GetRookAttacks(const uint8_t square, const uint64_t occupancy);
 extern uint64_t GetBishopAttacks(const uint8_t square, const uint64_t occupancy);
 extern uint64_t GetQueenAttacks(const uint8_t square, const uint64_t occupancy);
 extern uint64_t GetConnectingRay(const uint8_t from, const uint64_t to);
 
-// Attack lookup tables (generated at runtime)
-static MultiArray<uint64_t, 64, 4096> RookAttacks;
-static MultiArray<uint64_t, 64, 512> BishopAttacks;
-static MultiArray<uint64_t, 64, 64> ConnectingRays;
-
 // Pregenerated random magic numbers
 // Think of: https://xkcd.com/221/
 
@@ -0,0 +1,124 @@
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const std::string& path) {
+	Close();
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	FileHandle = file;
+	MappingHandle = mapping;
+	Data = static_cast<const uint8_t*>(view);
+	Size = static_cast<std::size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close() {
+	if (Data != nullptr) UnmapViewOfFile(Data);
+	if (MappingHandle != nullptr) CloseHandle(MappingHandle);
+	if (FileHandle != nullptr) CloseHandle(FileHandle);
+	Data = nullptr;
+	Size = 0;
+	FileHandle = nullptr;
+	MappingHandle = nullptr;
+}
+
+bool MappedFile::Create(const std::string& path, const void* contents, const std::size_t size) {
+	const std::string temporaryPath = path + ".tmp" + std::to_string(_getpid());
+	std::ofstream file(temporaryPath, std::ios::binary);
+	if (!file.is_open()) return false;
+	file.write(static_cast<const char*>(contents), size);
+	file.close();
+	if (!file || !MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+		std::remove(temporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+	Close();
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1) return false;
+	struct stat info{};
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // the mapping stays valid after closing the descriptor
+	if (mapping == MAP_FAILED) return false;
+	Data = static_cast<const uint8_t*>(mapping);
+	Size = static_cast<std::size_t>(info.st_size);
+	return true;
+}
+
+void MappedFile::Close() {
+	if (Data != nullptr) munmap(const_cast<uint8_t*>(Data), Size);
+	Data = nullptr;
+	Size = 0;
+}
+
+bool MappedFile::Create(const std::string& path, const void* contents, const std::size_t size) {
+	// Writing through a mapping instead of write() also works on hugetlbfs, where the file size
+	// has to be a multiple of the huge page size (the padding is harmless elsewhere)
+	constexpr std::size_t alignment = 2 * 1024 * 1024;
+	const std::size_t paddedSize = (size + alignment - 1) / alignment * alignment;
+	const std::string temporaryPath = path + ".tmp" + std::to_string(getpid());
+
+	const int fd = open(temporaryPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) return false;
+	bool success = ftruncate(fd, paddedSize) == 0;
+	if (success) {
+		void* mapping = mmap(nullptr, paddedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		success = mapping != MAP_FAILED;
+		if (success) {
+			std::memcpy(mapping, contents, size);
+			munmap(mapping, paddedSize);
+		}
+	}
+	close(fd);
+	if (!success || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+		unlink(temporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+* Read-only memory mapping of a file.
+* Mappings of the same file are backed by the same physical pages in every process, which allows
+* sharing large read-only data (like the network weights) between multiple engine instances.
+* Placing the file on tmpfs (/dev/shm) keeps it in memory, placing it on hugetlbfs also makes
+* the mapping use huge pages.
+*/
+
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	inline bool IsOpen() const {
+		return Data != nullptr;
+	}
+
+	inline const uint8_t* GetData() const {
+		return Data;
+	}
+
+	inline std::size_t GetSize() const {
+		return Size;
+	}
+
+	// Atomically creates a file with the given contents: it's written under a temporary name and renamed afterwards,
+	// so other processes either see the complete file or nothing at all
+	static bool Create(const std::string& path, const void* contents, const std::size_t size);
+
+private:
+	const uint8_t* Data = nullptr;
+	std::size_t Size = 0;
+#if defined(_WIN32)
+	void* FileHandle = nullptr;
+	void* MappingHandle = nullptr;
+#endif
+};
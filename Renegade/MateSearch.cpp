@@ -0,0 +1,174 @@
+#include "MateSearch.h"
+
+namespace {
+	constexpr std::size_t MateTableSize = 1 << 20;
+	constexpr uint64_t ChecksOnlySalt = 0x9E3779B97F4A7C15ull;
+	constexpr uint64_t RootSalt = 0xC2B2AE3D27D4EB4Full;
+	constexpr int MaxMateMoves = 100;
+}
+
+MateSolver::MateSolver(const std::function<bool(const uint64_t nodes)>& shouldAbort) {
+	ShouldAbort = shouldAbort;
+	Table.resize(MateTableSize);
+}
+
+MateSearchResult MateSolver::Solve(const Position& position, const int maxMoves, const std::function<bool(const Move&)>& rootFilter) {
+	MateSearchResult result{};
+	RootFilter = rootFilter;
+	Position pos = position;
+	const int limit = std::min(maxMoves, MaxMateMoves);
+
+	for (const bool checksOnly : { true, false }) {
+		ChecksOnly = checksOnly;
+		KeySalt = checksOnly ? ChecksOnlySalt : 0;
+
+		// The final move of a mate gives check, so the checks-only pass has already covered mates in one
+		for (int moves = checksOnly ? 1 : 2; moves <= limit; moves++) {
+			if (AttackerWins(pos, moves, true)) {
+				result.moves = moves;
+				result.pv = ExtractPv(position, moves);
+				break;
+			}
+			if (Aborted) break;
+		}
+		if (result.moves != 0 || Aborted) break;
+	}
+
+	result.nodes = Nodes;
+	result.aborted = Aborted;
+	return result;
+}
+
+// The attacker is to move, and needs to mate within the given number of moves
+bool MateSolver::AttackerWins(Position& position, const int movesLeft, const bool rootNode) {
+	if (CheckAbort()) return false;
+
+	const uint64_t key = GetKey(position, rootNode);
+	const Entry cached = Probe(key);
+	if (cached.key == key) {
+		if (cached.proven != 0 && cached.proven <= movesLeft) return true;
+		if (movesLeft <= cached.disproven) return false;
+	}
+
+	MoveList moves{};
+	position.GenerateMoves(moves, MoveGen::All, Legality::Legal);
+	const bool checksOnly = ChecksOnly || (movesLeft == 1);
+
+	// Checking moves are tried first, the others are kept for later (if they are allowed at all)
+	StaticVector<Move, MaxMoveCount> quietMoves;
+	Move winningMove = NullMove;
+
+	for (const ScoredMove& m : moves) {
+		if (rootNode && !RootFilter(m.move)) continue;
+		position.PushMove(m.move);
+		if (!position.IsInCheck()) {
+			position.PopMove();
+			if (!checksOnly) quietMoves.push(m.move);
+			continue;
+		}
+		const bool wins = DefenderLoses(position, movesLeft);
+		position.PopMove();
+		if (Aborted) return false;
+		if (wins) {
+			winningMove = m.move;
+			break;
+		}
+	}
+
+	if (winningMove.IsNull()) {
+		for (const Move& move : quietMoves) {
+			position.PushMove(move);
+			const bool wins = DefenderLoses(position, movesLeft);
+			position.PopMove();
+			if (Aborted) return false;
+			if (wins) {
+				winningMove = move;
+				break;
+			}
+		}
+	}
+
+	// Store the result, the entry might have been replaced during the search
+	Entry& entry = Probe(key);
+	if (entry.key != key) entry = { key, 0, 0, 0 };
+	if (!winningMove.IsNull()) {
+		if (entry.proven == 0 || movesLeft < entry.proven) {
+			entry.proven = static_cast<uint8_t>(movesLeft);
+			entry.move = winningMove.Pack();
+		}
+		return true;
+	}
+	entry.disproven = std::max(entry.disproven, static_cast<uint8_t>(movesLeft));
+	return false;
+}
+
+// The attacker has just moved, every reply of the defender must lose within the remaining moves
+bool MateSolver::DefenderLoses(Position& position, const int movesLeft) {
+	if (CheckAbort()) return false;
+
+	MoveList moves{};
+	position.GenerateMoves(moves, MoveGen::All, Legality::Legal);
+	if (moves.size() == 0) return position.IsInCheck();
+	if (movesLeft == 1) return false;
+
+	for (const ScoredMove& m : moves) {
+		position.PushMove(m.move);
+		const bool attackerWins = AttackerWins(position, movesLeft - 1, false);
+		position.PopMove();
+		if (!attackerWins) return false;
+	}
+	return !Aborted;
+}
+
+// Follows the proven mating moves, and the replies delaying the mate the longest
+std::vector<Move> MateSolver::ExtractPv(const Position& position, const int moves) {
+	std::vector<Move> pv{};
+	Position pos = position;
+	int movesLeft = moves;
+
+	while (movesLeft > 0) {
+		const bool rootNode = pv.empty();
+		if (!AttackerWins(pos, movesLeft, rootNode)) break;
+		const uint64_t key = GetKey(pos, rootNode);
+		const Entry& entry = Probe(key);
+		if (entry.key != key || entry.proven == 0) break;
+		const Move move = Move(entry.move);
+		pv.push_back(move);
+		pos.PushMove(move);
+
+		MoveList replies{};
+		pos.GenerateMoves(replies, MoveGen::All, Legality::Legal);
+		Move longestReply = NullMove;
+		int longestMoves = 0;
+		for (const ScoredMove& m : replies) {
+			pos.PushMove(m.move);
+			int mateMoves = 1;
+			while (mateMoves < movesLeft && !AttackerWins(pos, mateMoves, false) && !Aborted) mateMoves += 1;
+			pos.PopMove();
+			if (mateMoves > longestMoves) {
+				longestMoves = mateMoves;
+				longestReply = m.move;
+			}
+		}
+		if (longestReply.IsNull() || Aborted) break;
+		pv.push_back(longestReply);
+		pos.PushMove(longestReply);
+		movesLeft = longestMoves;
+	}
+	return pv;
+}
+
+// The root is stored separately, as its moves may be restricted, unlike when the same position is reached later
+uint64_t MateSolver::GetKey(const Position& position, const bool rootNode) const {
+	return position.Hash() ^ KeySalt ^ (rootNode ? RootSalt : 0);
+}
+
+MateSolver::Entry& MateSolver::Probe(const uint64_t hash) {
+	return Table[hash & (MateTableSize - 1)];
+}
+
+bool MateSolver::CheckAbort() {
+	Nodes += 1;
+	if (!Aborted && (Nodes % 1024 == 0) && ShouldAbort(Nodes)) Aborted = true;
+	return Aborted;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "Move.h"
+#include "Position.h"
+#include "Utils.h"
+#include <functional>
+#include <vector>
+
+/*
+* Exact mate finding for 'go mate N'.
+* This is a plain AND-OR search on the mate length: the attacker needs one move after which every reply of the
+* defender loses within the remaining moves. There is no evaluation and no pruning, so a proven mate is always
+* a real one, and the shortest mate is found by iterating on the length.
+* The first pass only tries checking moves for the attacker, which finds most puzzle mates very quickly, the
+* second pass tries every move (except for the final one, which has to give check anyway).
+* Draws by repetition or the fifty-move rule are not considered.
+*/
+
+struct MateSearchResult {
+	int moves = 0; // length of the mate found (0 if none)
+	std::vector<Move> pv;
+	uint64_t nodes = 0;
+	bool aborted = false;
+};
+
+class MateSolver {
+public:
+	// The abort callback is checked periodically, the search unwinds once it returns true
+	MateSolver(const std::function<bool(const uint64_t nodes)>& shouldAbort);
+	// Only the root moves accepted by the filter are tried (for 'go searchmoves')
+	MateSearchResult Solve(const Position& position, const int maxMoves, const std::function<bool(const Move&)>& rootFilter);
+
+private:
+	struct Entry {
+		uint64_t key = 0;
+		uint16_t move = 0;    // a mating move for 'proven' moves
+		uint8_t proven = 0;   // mate in this many moves proven (0: unknown)
+		uint8_t disproven = 0; // no mate in this many moves or less
+	};
+
+	bool AttackerWins(Position& position, const int movesLeft, const bool rootNode);
+	bool DefenderLoses(Position& position, const int movesLeft);
+	std::vector<Move> ExtractPv(const Position& position, const int moves);
+	uint64_t GetKey(const Position& position, const bool rootNode) const;
+	Entry& Probe(const uint64_t hash);
+	bool CheckAbort();
+
+	std::function<bool(const uint64_t nodes)> ShouldAbort;
+	std::function<bool(const Move&)> RootFilter;
+	std::vector<Entry> Table;
+	uint64_t Nodes = 0;
+	uint64_t KeySalt = 0;
+	bool ChecksOnly = false;
+	bool Aborted = false;
+};
@@ -4,54 +4,244 @@
 #include "Utils.h"
 #include <algorithm>
 #include <array>
+#include <bit>
+#include <immintrin.h>
+#include <limits>
+
+// Staged move picker: moves are generated and scored only when they are about to be needed
+// Stages: TT move -> good noisy moves -> killer -> countermove -> quiet moves -> bad noisy moves
+// The TT, killer and countermove are checked for pseudolegality without generating any moves,
+// and many nodes produce a cutoff before quiet moves would need to be generated at all
+// Within a stage moves are selected one by one (selection sort), the scores are also kept in a separate
+// packed array so that finding the best one can be vectorized
+
+// What is known about the SEE value of a move: lower <= value < upper (exactly known if upper = lower + 1)
+struct SeeBounds {
+	int lower = std::numeric_limits<int>::min();
+	int upper = std::numeric_limits<int>::max();
+};
+
+enum class MovePickerStage { TTMove, GenerateNoisy, GoodNoisy, Killer, Counter, GenerateQuiet, Quiet, BadNoisy, Done };
 
 class MovePicker {
 public:
 	MovePicker() = default;
 
 	void Initialize(const MoveGen moveGen, const Position& pos, const Histories& hist, const Move& ttMove, const int level) {
+		this->position = &pos;
+		this->history = &hist;
 		this->ttMove = ttMove;
 		this->killerMove = hist.GetKillerMove(level);
 		this->counterMove = (level > 0) ? hist.GetCountermove(pos.GetPreviousMove(1).move) : NullMove;
 		this->level = level;
 		this->moveGen = moveGen;
 		this->moves.clear();
-		index = 0;
+		stage = MovePickerStage::TTMove;
+		noisyGenerated = false;
+		quietGenerated = false;
+		noisyEnd = 0;
+		noisyIndex = 0;
+		quietIndex = 0;
+		seeContextReady = false;
+	}
+
+	std::pair<Move, int> Get() const {
+		return current;
+	}
 
-		pos.GenerateMoves(moves, moveGen, Legality::Pseudolegal);
-		for (auto& m : moves) m.orderScore = GetMoveScore(pos, hist, m.move);
+	// SEE for the move last returned by Get(), reusing what is already known about it from move ordering
+	// If the previous results can't answer the question, the exact value is calculated, so that any further
+	// queries for the same move are free
+	bool StaticExchangeEval(const int threshold) {
+		if (threshold <= currentSee.lower) return true;
+		if (threshold >= currentSee.upper) return false;
+		return StaticExchangeValue() >= threshold;
 	}
 
-	std::pair<Move, int> Get() {
-		assert(HasNext());
+	// Exact SEE value for the move last returned by Get()
+	int StaticExchangeValue() {
+		if (currentSee.upper != currentSee.lower + 1) {
+			const int value = position->StaticExchangeValue(current.first, GetSeeContext());
+			currentSee = { value, value + 1 };
+		}
+		return currentSee.lower;
+	}
 
-		int bestOrderScore = moves[index].orderScore;
-		int bestIndex = index;
+	// Advances to the next move, returns false if there are no moves left
+	bool HasNext() {
+		while (true) {
+			switch (stage) {
 
-		for (int i = index + 1; i < moves.size(); i++) {
-			if (moves[i].orderScore > bestOrderScore) {
-				bestOrderScore = moves[i].orderScore;
-				bestIndex = i;
+			case MovePickerStage::TTMove:
+				stage = MovePickerStage::GenerateNoisy;
+				if (!ttMove.IsNull() && position->IsPseudoLegal(ttMove, moveGen)) {
+					current = { ttMove, 900000 };
+					currentSee = {};
+					return true;
+				}
+				ttMove = NullMove;
+				break;
+
+			case MovePickerStage::GenerateNoisy:
+				if (!noisyGenerated) GenerateAndScore(MoveGen::Noisy);
+				noisyIndex = 0;
+				stage = MovePickerStage::GoodNoisy;
+				break;
+
+			case MovePickerStage::GoodNoisy:
+				if (noisyIndex < noisyEnd) {
+					SelectBest(noisyIndex, noisyEnd);
+					if (scores[noisyIndex] > BadNoisyThreshold) {
+						current = { moves[noisyIndex].move, scores[noisyIndex] };
+						currentSee = seeBounds[noisyIndex];
+						noisyIndex += 1;
+						return true;
+					}
+				}
+				stage = (moveGen == MoveGen::All) ? MovePickerStage::Killer : MovePickerStage::Done;
+				break;
+
+			case MovePickerStage::Killer:
+				stage = MovePickerStage::Counter;
+				if (!killerMove.IsNull() && killerMove != ttMove && position->IsPseudoLegal(killerMove, MoveGen::Quiet)) {
+					current = { killerMove, 100000 };
+					currentSee = {};
+					return true;
+				}
+				killerMove = NullMove;
+				break;
+
+			case MovePickerStage::Counter:
+				stage = MovePickerStage::GenerateQuiet;
+				if (!counterMove.IsNull() && counterMove != ttMove && counterMove != killerMove && position->IsPseudoLegal(counterMove, MoveGen::Quiet)) {
+					current = { counterMove, 99000 };
+					currentSee = {};
+					return true;
+				}
+				counterMove = NullMove;
+				break;
+
+			case MovePickerStage::GenerateQuiet:
+				if (!quietGenerated) GenerateAndScore(MoveGen::Quiet);
+				quietIndex = noisyEnd;
+				stage = MovePickerStage::Quiet;
+				break;
+
+			case MovePickerStage::Quiet:
+				if (quietIndex < moves.size()) {
+					SelectBest(quietIndex, moves.size());
+					current = { moves[quietIndex].move, scores[quietIndex] };
+					currentSee = seeBounds[quietIndex];
+					quietIndex += 1;
+					return true;
+				}
+				stage = MovePickerStage::BadNoisy;
+				break;
+
+			case MovePickerStage::BadNoisy:
+				if (noisyIndex < noisyEnd) {
+					SelectBest(noisyIndex, noisyEnd);
+					current = { moves[noisyIndex].move, scores[noisyIndex] };
+					currentSee = seeBounds[noisyIndex];
+					noisyIndex += 1;
+					return true;
+				}
+				stage = MovePickerStage::Done;
+				break;
+
+			case MovePickerStage::Done:
+				return false;
 			}
 		}
+	}
 
-		std::swap(moves[bestIndex], moves[index]);
-		index += 1;
-		return { moves[index - 1].move, moves[index - 1].orderScore };
+	// Restart right after the TT move (used after singular searches, which continue with the same picker)
+	// Moves that are already generated and scored are kept, iterating them again gives the same order
+	void Rewind() {
+		assert(stage != MovePickerStage::TTMove);
+		stage = MovePickerStage::GenerateNoisy;
 	}
 
-	bool HasNext() const {
-		return index < moves.size();
+private:
+
+	void GenerateAndScore(const MoveGen stageMoveGen) {
+		const ScopedPhaseTimer timer(ProfilerPhase::MovePicker);
+		const std::size_t first = moves.size();
+		position->GenerateMoves(moves, stageMoveGen, Legality::Pseudolegal);
+
+		// Remove the moves already tried in an earlier stage, and score the rest
+		std::size_t last = first;
+		for (std::size_t i = first; i < moves.size(); i++) {
+			const Move m = moves[i].move;
+			if (m == ttMove || (stageMoveGen == MoveGen::Quiet && (m == killerMove || m == counterMove))) continue;
+			SeeBounds see{};
+			const int score = GetMoveScore(*position, *history, m, see);
+			moves[last] = { m, score };
+			scores[last] = score;
+			seeBounds[last] = see;
+			last += 1;
+		}
+		while (moves.size() > last) moves.pop();
+
+		if (stageMoveGen == MoveGen::Noisy) {
+			noisyGenerated = true;
+			noisyEnd = moves.size();
+		}
+		else quietGenerated = true;
 	}
 
-	int index;
+	void SelectBest(const std::size_t from, const std::size_t to) {
+		const std::size_t bestIndex = FindBestIndex(from, to);
+		std::swap(moves[bestIndex], moves[from]);
+		std::swap(scores[bestIndex], scores[from]);
+		std::swap(seeBounds[bestIndex], seeBounds[from]);
+	}
 
-private:
+	std::size_t FindBestIndex(const std::size_t from, const std::size_t to) const {
+		// Returns the first index with the highest score in [from, to)
+#ifdef __AVX2__
+		if (to - from >= 16) {
+			const auto load = [&](const std::size_t i) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&scores[i])); };
 
-	int GetMoveScore(const Position& pos, const Histories& hist, const Move& m) const {
+			// 1. Find the highest score
+			std::size_t i = from + 8;
+			auto best = load(from);
+			for (; i + 8 <= to; i += 8) best = _mm256_max_epi32(best, load(i));
+			auto best128 = _mm_max_epi32(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+			best128 = _mm_max_epi32(best128, _mm_shuffle_epi32(best128, _MM_SHUFFLE(1, 0, 3, 2)));
+			best128 = _mm_max_epi32(best128, _mm_shuffle_epi32(best128, _MM_SHUFFLE(2, 3, 0, 1)));
+			int bestScore = _mm_cvtsi128_si32(best128);
+			for (; i < to; i++) bestScore = std::max(bestScore, scores[i]);
 
-		// Transposition move
-		if (m == ttMove) return 900000;
+			// 2. Find where it first occurs
+			const auto target = _mm256_set1_epi32(bestScore);
+			for (i = from; i + 8 <= to; i += 8) {
+				const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(load(i), target)));
+				if (mask != 0) return i + std::countr_zero(static_cast<unsigned int>(mask));
+			}
+			for (; i < to; i++) if (scores[i] == bestScore) return i;
+		}
+#endif
+		int bestScore = scores[from];
+		std::size_t bestIndex = from;
+		for (std::size_t i = from + 1; i < to; i++) {
+			if (scores[i] > bestScore) {
+				bestScore = scores[i];
+				bestIndex = i;
+			}
+		}
+		return bestIndex;
+	}
+
+	const SeeContext& GetSeeContext() {
+		if (!seeContextReady) {
+			seeContext = position->GetSeeContext();
+			seeContextReady = true;
+		}
+		return seeContext;
+	}
+
+	int GetMoveScore(const Position& pos, const Histories& hist, const Move& m, SeeBounds& see) {
 
 		constexpr std::array<int, 7> values = { 0, 100, 300, 300, 500, 900, 0 };
 		const uint8_t movedPiece = pos.GetPieceAt(m.from);
@@ -72,27 +262,36 @@ private:
 				if (moveGen == MoveGen::Noisy) return false;
 				if (pos.IsMoveQuiet(m)) return false;
 				const int16_t captureScore = (m.IsPromotion()) ? 0 : hist.GetCaptureHistoryScore(pos, m);
-				return !pos.StaticExchangeEval(m, -captureScore / 32);
+				const int value = pos.StaticExchangeValue(m, GetSeeContext());
+				see = { value, value + 1 };
+				return value < -captureScore / 32;
 			}();
 
 			if (!losingCapture) return 600000 + values[capturedPieceType] * 16 + hist.GetCaptureHistoryScore(pos, m);
 			else return -200000 + values[capturedPieceType] * 16 + hist.GetCaptureHistoryScore(pos, m);
 		}
 
-		// Quiet killer moves
-		if (m == killerMove) return 100000;
-
-		// Countermove heuristic
-		if (m == counterMove) return 99000;
-
 		// Quiet moves
 		const int historyScore = hist.GetHistoryScore(pos, m, movedPiece, level);
 		return historyScore;
 	}
 
 
+	static constexpr int BadNoisyThreshold = -100000; // losing captures are scored around -200000
+
+	const Position* position = nullptr;
+	const Histories* history = nullptr;
 	Move ttMove{}, killerMove{}, counterMove{};
 	MoveList moves{};
+	alignas(32) std::array<int, MaxMoveCount> scores{};
+	std::array<SeeBounds, MaxMoveCount> seeBounds{};
+	std::pair<Move, int> current{};
+	SeeBounds currentSee{};
+	SeeContext seeContext{};
+	bool seeContextReady = false;
+	MovePickerStage stage = MovePickerStage::Done;
+	bool noisyGenerated = false, quietGenerated = false;
+	std::size_t noisyEnd = 0, noisyIndex = 0, quietIndex = 0;
 	int level = 0;
 	MoveGen moveGen = MoveGen::All;
 };
\ No newline at end of file
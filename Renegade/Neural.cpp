@@ -18,6 +18,7 @@
 INCBIN(DefaultNetwork, NETWORK_NAME);
 const NetworkRepresentation* Network;
 std::unique_ptr<NetworkRepresentation> ExternalNetwork;
+std::unique_ptr<MappedFile> SharedNetworkFile;
 
 // Evaluating the position ------------------------------------------------------------------------
 
@@ -100,6 +101,7 @@ int16_t NeuralEvaluate(const Position& position) {
 // Evaluation call & accumulator updates ----------------------------------------------------------
 
 int16_t EvaluationState::Evaluate(const Position& pos) {
+	const ScopedPhaseTimer timer(ProfilerPhase::Evaluate);
 
 	// For evaluating, we need to make sure the accumulator is up-to-date for both sides
 	// The accumulators can be updated in two ways, in order of preference:
@@ -296,4 +298,77 @@ void LoadDefaultNetwork() {
 	else cout << "Loaded '" << NETWORK_NAME << "', but it stinks";
 	cout << " (startpos raw eval: " << startposEval << ")" << endl;
 #endif
-}
\ No newline at end of file
+}
+
+// Sharing the network between processes ----------------------------------------------------------
+
+// The shared file starts with this header, followed by the network weights
+struct SharedNetworkHeader {
+	std::array<char, 8> Magic{};
+	uint64_t NetworkSize = 0;
+	std::array<char, 48> NetworkName{};
+};
+static_assert(sizeof(SharedNetworkHeader) == 64); // keeps the weights 64-byte aligned
+constexpr std::array<char, 8> SharedNetworkMagic = { 'R', 'e', 'n', 'e', 'g', 'a', 'd', 'e' };
+
+static SharedNetworkHeader CreateSharedNetworkHeader() {
+	SharedNetworkHeader header{};
+	header.Magic = SharedNetworkMagic;
+	header.NetworkSize = sizeof(NetworkRepresentation);
+	std::strncpy(header.NetworkName.data(), NETWORK_NAME, header.NetworkName.size() - 1);
+	return header;
+}
+
+static bool IsSharedNetworkValid(const MappedFile& file, const NetworkRepresentation* expected) {
+	// Checking the header, and comparing evenly spaced samples of the weights with the network currently in use
+	// (comparing every byte would defeat the purpose by touching all the pages of the private copy)
+	if (file.GetSize() < sizeof(SharedNetworkHeader) + sizeof(NetworkRepresentation)) return false;
+	const SharedNetworkHeader header = CreateSharedNetworkHeader();
+	if (std::memcmp(file.GetData(), &header, sizeof(SharedNetworkHeader)) != 0) return false;
+
+	const uint8_t* shared = file.GetData() + sizeof(SharedNetworkHeader);
+	const uint8_t* current = reinterpret_cast<const uint8_t*>(expected);
+	constexpr std::size_t sampleCount = 256, sampleSize = 256;
+	for (std::size_t i = 0; i < sampleCount; i++) {
+		const std::size_t offset = (sizeof(NetworkRepresentation) - sampleSize) / (sampleCount - 1) * i;
+		if (std::memcmp(shared + offset, current + offset, sampleSize) != 0) return false;
+	}
+	return std::memcmp(shared + sizeof(NetworkRepresentation) - sampleSize, current + sizeof(NetworkRepresentation) - sampleSize, sampleSize) == 0;
+}
+
+bool UseSharedNetwork(const std::string& path) {
+	// An empty path switches back to the network owned by this process
+	if (path.empty()) {
+		if (SharedNetworkFile == nullptr) return true;
+		LoadDefaultNetwork();
+		SharedNetworkFile.reset();
+		cout << "info string Using the network of this process" << endl;
+		return true;
+	}
+	if (Network == nullptr) return false;
+
+	// Attach to the file if another process has already created it, otherwise create it
+	std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>();
+	bool created = false;
+	if (!file->Open(path)) {
+		std::vector<uint8_t> contents(sizeof(SharedNetworkHeader) + sizeof(NetworkRepresentation));
+		const SharedNetworkHeader header = CreateSharedNetworkHeader();
+		std::memcpy(contents.data(), &header, sizeof(SharedNetworkHeader));
+		std::memcpy(contents.data() + sizeof(SharedNetworkHeader), Network, sizeof(NetworkRepresentation));
+		created = MappedFile::Create(path, contents.data(), contents.size());
+		if (!created || !file->Open(path)) {
+			cout << "info string Could not create shared network file '" << path << "'" << endl;
+			return false;
+		}
+	}
+	if (!IsSharedNetworkValid(*file, Network)) {
+		cout << "info string Shared network file '" << path << "' contains a different network" << endl;
+		return false;
+	}
+
+	Network = reinterpret_cast<const NetworkRepresentation*>(file->GetData() + sizeof(SharedNetworkHeader));
+	std::swap(SharedNetworkFile, file);
+	ExternalNetwork.reset(); // no longer needed if it was loaded from disk
+	cout << "info string " << (created ? "Created" : "Attached to") << " shared network file '" << path << "'" << endl;
+	return true;
+}
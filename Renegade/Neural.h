@@ -1,12 +1,16 @@
 #pragma once
+#include "MappedFile.h"
 #include "Position.h"
 #include <algorithm>
 #include <array>
+#include <cstring>
 #include <fstream>
 #include <immintrin.h>
 #include <iterator>
 #include <memory>
 #include <optional>
+#include <string>
+#include <vector>
 
 // This is the code for the NNUE evaluation
 // Renegade uses a horizontally mirrored perspective net with input buckets based on the king's
@@ -57,6 +61,7 @@ struct AccumulatorRepresentation;
 int16_t NeuralEvaluate(const Position& position);
 int16_t NeuralEvaluate(const Position& position, const AccumulatorRepresentation& acc);
 void LoadDefaultNetwork();
+bool UseSharedNetwork(const std::string& path);
 
 inline int GetInputBucket(const uint8_t kingSq, const bool side) {
 	const uint8_t transform = side == Side::White ? 0 : 56;
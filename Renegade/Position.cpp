@@ -206,10 +206,25 @@ Position::Position(const int frcWhite, const int frcBlack) {
 	Threats.push_back(CalculateAttackedSquares(!Turn()));
 }
 
+Position::Position(const Board& board, const CastlingConfiguration& castling) {
+	// For restoring positions from a compact representation without going through FEN strings
+	// The board has to be consistent: the bitboards and the mailbox must describe the same pieces
+	States.reserve(512);
+	Hashes.reserve(512);
+	Moves.reserve(512);
+	Threats.reserve(512);
+	States.push_back(board);
+	CastlingConfig = castling;
+
+	Hashes.push_back(board.CalculateHash());
+	Threats.push_back(CalculateAttackedSquares(!Turn()));
+}
+
 // Pushing moves ----------------------------------------------------------------------------------
 
 void Position::PushMove(const Move& move) {
 	assert(!move.IsNull());
+	const ScopedPhaseTimer timer(ProfilerPhase::MakeMove);
 
 	States.push_back(Board(CurrentState()));
 	Board& board = CurrentState();
@@ -307,6 +322,7 @@ bool Position::PushUCI(const std::string& str) {
 }
 
 void Position::PopMove() {
+	const ScopedPhaseTimer timer(ProfilerPhase::MakeMove);
 	States.pop_back();
 	Hashes.pop_back();
 	Moves.pop_back();
@@ -323,7 +339,8 @@ void Position::GenerateKingMoves(MoveList& moves, const int home) const {
 	while (bits) {
 		const uint8_t l = Popsquare(bits);
 		if (ColorOfPiece(GetPieceAt(l)) == friendlyPieceColor) continue;
-		if ((moveGen == MoveGen::All) || (ColorOfPiece(GetPieceAt(l)) == opponentPieceColor)) moves.pushUnscored(Move(home, l));
+		const bool capture = ColorOfPiece(GetPieceAt(l)) == opponentPieceColor;
+		if ((moveGen == MoveGen::All) || ((moveGen == MoveGen::Noisy) == capture)) moves.pushUnscored(Move(home, l));
 	}
 }
 
@@ -335,7 +352,8 @@ void Position::GenerateKnightMoves(MoveList& moves, const int home) const {
 	while (bits) {
 		const uint8_t l = Popsquare(bits);
 		if (ColorOfPiece(GetPieceAt(l)) == friendlyPieceColor) continue;
-		if ((moveGen == MoveGen::All) || (ColorOfPiece(GetPieceAt(l)) == opponentPieceColor)) moves.pushUnscored(Move(home, l));
+		const bool capture = ColorOfPiece(GetPieceAt(l)) == opponentPieceColor;
+		if ((moveGen == MoveGen::All) || ((moveGen == MoveGen::Noisy) == capture)) moves.pushUnscored(Move(home, l));
 	}
 }
 
@@ -351,6 +369,7 @@ void Position::GenerateSlidingMoves(MoveList& moves, const int home, const uint6
 	if constexpr (pieceType == PieceType::Queen) map = GetQueenAttacks(home, occupancy) & ~friendlyOccupancy;
 
 	if constexpr (moveGen == MoveGen::Noisy) map &= opponentOccupancy;
+	if constexpr (moveGen == MoveGen::Quiet) map &= ~opponentOccupancy;
 	if (map == 0) return;
 
 	while (map != 0) {
@@ -384,11 +403,11 @@ void Position::GeneratePawnMoves(MoveList& moves, const int home) const {
 	target = home + forwardDelta;
 	if (GetPieceAt(target) == Piece::None) {
 		if (GetSquareRank(target) != promotionRank) {
-			if constexpr (moveGen == MoveGen::All) moves.pushUnscored(Move(home, target));
+			if constexpr (moveGen != MoveGen::Noisy) moves.pushUnscored(Move(home, target));
 		}
 		else { // Promote
-			moves.pushUnscored(Move(home, target, MoveFlag::PromotionToQueen));
-			if constexpr (moveGen == MoveGen::All) {
+			if constexpr (moveGen != MoveGen::Quiet) moves.pushUnscored(Move(home, target, MoveFlag::PromotionToQueen));
+			if constexpr (moveGen != MoveGen::Noisy) {
 				moves.pushUnscored(Move(home, target, MoveFlag::PromotionToRook));
 				moves.pushUnscored(Move(home, target, MoveFlag::PromotionToBishop));
 				moves.pushUnscored(Move(home, target, MoveFlag::PromotionToKnight));
@@ -406,11 +425,11 @@ void Position::GeneratePawnMoves(MoveList& moves, const int home) const {
 		if ((file != wrongFile) && ((ColorOfPiece(GetPieceAt(target)) == opponentPieceColor) || (target == b.EnPassantSquare))) {
 			if (GetSquareRank(target) != promotionRank) {
 				const uint8_t moveFlag = (target == b.EnPassantSquare) ? MoveFlag::EnPassantPerformed : MoveFlag::None;
-				moves.pushUnscored(Move(home, target, moveFlag));
+				if constexpr (moveGen != MoveGen::Quiet) moves.pushUnscored(Move(home, target, moveFlag));
 			}
 			else { // Promote
-				moves.pushUnscored(Move(home, target, MoveFlag::PromotionToQueen));
-				if constexpr (moveGen == MoveGen::All) {
+				if constexpr (moveGen != MoveGen::Quiet) moves.pushUnscored(Move(home, target, MoveFlag::PromotionToQueen));
+				if constexpr (moveGen != MoveGen::Noisy) {
 					moves.pushUnscored(Move(home, target, MoveFlag::PromotionToRook));
 					moves.pushUnscored(Move(home, target, MoveFlag::PromotionToBishop));
 					moves.pushUnscored(Move(home, target, MoveFlag::PromotionToKnight));
@@ -424,7 +443,7 @@ void Position::GeneratePawnMoves(MoveList& moves, const int home) const {
 		const bool free1 = GetPieceAt(home + forwardDelta) == Piece::None;
 		const bool free2 = GetPieceAt(home + doublePushDelta) == Piece::None;
 		if (free1 && free2) {
-			if constexpr (moveGen == MoveGen::All) moves.pushUnscored(Move(home, home + doublePushDelta, MoveFlag::EnPassantPossible));
+			if constexpr (moveGen != MoveGen::Noisy) moves.pushUnscored(Move(home, home + doublePushDelta, MoveFlag::EnPassantPossible));
 		}
 	}
 
@@ -433,56 +452,53 @@ void Position::GeneratePawnMoves(MoveList& moves, const int home) const {
 template <bool side>
 void Position::GenerateCastlingMoves(MoveList& moves) const {
 
-	using namespace Squares;
 	const Board& b = CurrentState();
+	const uint8_t kingSq = LsbSquare((side == Side::White) ? b.WhiteKingBits : b.BlackKingBits);
 
-	const bool rightToShortCastle = (side == Side::White) ? b.WhiteRightToShortCastle : b.BlackRightToShortCastle;
-	const bool rightToLongCastle = (side == Side::White) ? b.WhiteRightToLongCastle : b.BlackRightToLongCastle;
-	if (!rightToShortCastle && !rightToLongCastle) return;
-
-	const uint64_t friendlyKing = (side == Side::White) ? b.WhiteKingBits : b.BlackKingBits;
-	const uint8_t kingSq = LsbSquare(friendlyKing);
-	const uint64_t occupancy = GetOccupancy();
-
-	if (rightToShortCastle) {
-		
-		constexpr uint8_t kingTo = (side == Side::White) ? G1 : G8;
-		constexpr uint8_t rookTo = (side == Side::White) ? F1 : F8;
-
+	if (IsCastlingPossible<side>(true)) {
 		const uint8_t rookSq = (side == Side::White) ? CastlingConfig.WhiteShortCastleRookSquare : CastlingConfig.BlackShortCastleRookSquare;
-		const uint64_t rayBetweenKingAndG = GetConnectingRay(kingSq, kingTo);
-		const uint64_t rayBetweenRookAndF = GetConnectingRay(rookSq, rookTo);
-		const uint64_t fakeOccupancy = occupancy ^ (SquareBit(kingSq) | SquareBit(rookSq));
-		const bool empty = !((rayBetweenKingAndG | rayBetweenRookAndF) & fakeOccupancy);
-
-		if (empty) {
-			const uint64_t opponentAttacks = Threats.back();
-			const bool safe = !(opponentAttacks & rayBetweenKingAndG);
-			if (safe) moves.pushUnscored(Move(kingSq, rookSq, MoveFlag::ShortCastle));
-		}
+		moves.pushUnscored(Move(kingSq, rookSq, MoveFlag::ShortCastle));
 	}
-
-	if (rightToLongCastle) {
-
-		constexpr uint8_t kingTo = (side == Side::White) ? C1 : C8;
-		constexpr uint8_t rookTo = (side == Side::White) ? D1 : D8;
-
+	if (IsCastlingPossible<side>(false)) {
 		const uint8_t rookSq = (side == Side::White) ? CastlingConfig.WhiteLongCastleRookSquare : CastlingConfig.BlackLongCastleRookSquare;
-		const uint64_t rayBetweenKingAndC = GetConnectingRay(kingSq, kingTo);
-		const uint64_t rayBetweenRookAndF = GetConnectingRay(rookSq, rookTo);
-		const uint64_t fakeOccupancy = occupancy ^ (SquareBit(kingSq) | SquareBit(rookSq));
-		const bool empty = !((rayBetweenKingAndC | rayBetweenRookAndF) & fakeOccupancy);
+		moves.pushUnscored(Move(kingSq, rookSq, MoveFlag::LongCastle));
+	}
+}
 
-		if (empty) {
-			const uint64_t opponentAttacks = Threats.back();
-			const bool safe = !(opponentAttacks & rayBetweenKingAndC);
-			if (safe) moves.pushUnscored(Move(kingSq, rookSq, MoveFlag::LongCastle));
-		}
+template <bool side>
+bool Position::IsCastlingPossible(const bool shortCastle) const {
 
-	}
+	using namespace Squares;
+	const Board& b = CurrentState();
+
+	const bool rightToCastle = [&] {
+		if (side == Side::White) return shortCastle ? b.WhiteRightToShortCastle : b.WhiteRightToLongCastle;
+		else return shortCastle ? b.BlackRightToShortCastle : b.BlackRightToLongCastle;
+	}();
+	if (!rightToCastle) return false;
+
+	const uint8_t kingSq = LsbSquare((side == Side::White) ? b.WhiteKingBits : b.BlackKingBits);
+	const uint8_t kingTo = (side == Side::White) ? (shortCastle ? G1 : C1) : (shortCastle ? G8 : C8);
+	const uint8_t rookTo = (side == Side::White) ? (shortCastle ? F1 : D1) : (shortCastle ? F8 : D8);
+	const uint8_t rookSq = [&] {
+		if (side == Side::White) return shortCastle ? CastlingConfig.WhiteShortCastleRookSquare : CastlingConfig.WhiteLongCastleRookSquare;
+		else return shortCastle ? CastlingConfig.BlackShortCastleRookSquare : CastlingConfig.BlackLongCastleRookSquare;
+	}();
+
+	// The squares between the king and its destination, and the rook and its destination must be empty
+	const uint64_t rayBetweenKingAndTarget = GetConnectingRay(kingSq, kingTo);
+	const uint64_t rayBetweenRookAndTarget = GetConnectingRay(rookSq, rookTo);
+	const uint64_t fakeOccupancy = GetOccupancy() ^ (SquareBit(kingSq) | SquareBit(rookSq));
+	const bool empty = !((rayBetweenKingAndTarget | rayBetweenRookAndTarget) & fakeOccupancy);
+	if (!empty) return false;
+
+	// The king can't pass through attacked squares
+	const uint64_t opponentAttacks = Threats.back();
+	return !(opponentAttacks & rayBetweenKingAndTarget);
 }
 
 void Position::GenerateMoves(MoveList& moves, const MoveGen moveGen, const Legality legality) const {
+	const ScopedPhaseTimer timer(ProfilerPhase::GenerateMoves);
 
 	const Board& board = CurrentState();
 
@@ -495,6 +511,10 @@ void Position::GenerateMoves(MoveList& moves, const MoveGen moveGen, const Legal
 			if (board.Turn == Side::White) GeneratePseudolegalMoves<Side::White, MoveGen::Noisy>(moves);
 			else GeneratePseudolegalMoves<Side::Black, MoveGen::Noisy>(moves);
 		}
+		else if (moveGen == MoveGen::Quiet) {
+			if (board.Turn == Side::White) GeneratePseudolegalMoves<Side::White, MoveGen::Quiet>(moves);
+			else GeneratePseudolegalMoves<Side::Black, MoveGen::Quiet>(moves);
+		}
 	}
 	else {
 		MoveList legalMoves{};
@@ -506,6 +526,10 @@ void Position::GenerateMoves(MoveList& moves, const MoveGen moveGen, const Legal
 			if (board.Turn == Side::White) GeneratePseudolegalMoves<Side::White, MoveGen::Noisy>(legalMoves);
 			else GeneratePseudolegalMoves<Side::Black, MoveGen::Noisy>(legalMoves);
 		}
+		else if (moveGen == MoveGen::Quiet) {
+			if (board.Turn == Side::White) GeneratePseudolegalMoves<Side::White, MoveGen::Quiet>(legalMoves);
+			else GeneratePseudolegalMoves<Side::Black, MoveGen::Quiet>(legalMoves);
+		}
 		for (const auto& m : legalMoves) {
 			if (IsLegalMove(m.move)) moves.pushUnscored(m.move);
 		}
@@ -540,13 +564,90 @@ void Position::GeneratePseudolegalMoves(MoveList& moves) const {
 			break;
 		case PieceType::King:
 			GenerateKingMoves<side, moveGen>(moves, sq);
-			if constexpr (moveGen == MoveGen::All) GenerateCastlingMoves<side>(moves);
+			if constexpr (moveGen != MoveGen::Noisy) GenerateCastlingMoves<side>(moves);
 			break;
 
 		}
 	}
 }
 
+bool Position::IsPseudoLegal(const Move& move, const MoveGen moveGen) const {
+	// Checks whether the move would be generated in the current position, working only from bitboards
+	// This is used for validating moves coming from the transposition table and the history heuristics
+	const Board& b = CurrentState();
+	const bool side = b.Turn;
+	if (move.IsNull() || move.from > 63 || move.to > 63) return false;
+	const uint8_t movedPiece = GetPieceAt(move.from);
+	if (movedPiece == Piece::None || ColorOfPiece(movedPiece) != SideToPieceColor(side)) return false;
+	const uint8_t pieceType = TypeOfPiece(movedPiece);
+
+	// Castling: encoded as king to rook, generated for all and quiet moves
+	if (move.IsCastling()) {
+		if (pieceType != PieceType::King || moveGen == MoveGen::Noisy) return false;
+		const bool shortCastle = move.flag == MoveFlag::ShortCastle;
+		const uint8_t rookSq = [&] {
+			if (side == Side::White) return shortCastle ? CastlingConfig.WhiteShortCastleRookSquare : CastlingConfig.WhiteLongCastleRookSquare;
+			else return shortCastle ? CastlingConfig.BlackShortCastleRookSquare : CastlingConfig.BlackLongCastleRookSquare;
+		}();
+		if (move.to != rookSq) return false;
+		return (side == Side::White) ? IsCastlingPossible<Side::White>(shortCastle) : IsCastlingPossible<Side::Black>(shortCastle);
+	}
+
+	const uint64_t friendlyOccupancy = GetOccupancy(side);
+	const uint64_t opponentOccupancy = GetOccupancy(!side);
+	const uint64_t occupancy = friendlyOccupancy | opponentOccupancy;
+	if (CheckBit(friendlyOccupancy, move.to)) return false;
+	const bool capture = CheckBit(opponentOccupancy, move.to);
+
+	// Non-pawn pieces
+	if (pieceType != PieceType::Pawn) {
+		if (move.flag != MoveFlag::None) return false;
+		const uint64_t attacks = [&] {
+			switch (pieceType) {
+			case PieceType::Knight: return KnightMoveBits[move.from];
+			case PieceType::Bishop: return GetBishopAttacks(move.from, occupancy);
+			case PieceType::Rook: return GetRookAttacks(move.from, occupancy);
+			case PieceType::Queen: return GetQueenAttacks(move.from, occupancy);
+			default: return KingMoveBits[move.from];
+			}
+		}();
+		if (!CheckBit(attacks, move.to)) return false;
+		return (moveGen == MoveGen::All) || ((moveGen == MoveGen::Noisy) == capture);
+	}
+
+	// Pawn moves
+	const int forwardDelta = (side == Side::White) ? 8 : -8;
+	const int promotionRank = (side == Side::White) ? 7 : 0;
+	const int doublePushRank = (side == Side::White) ? 1 : 6;
+	const uint64_t fromBit = SquareBit(move.from);
+	const uint64_t pawnAttacks = (side == Side::White) ? (((fromBit & ~File[0]) << 7) | ((fromBit & ~File[7]) << 9))
+		: (((fromBit & ~File[0]) >> 9) | ((fromBit & ~File[7]) >> 7));
+	if ((GetSquareRank(move.to) == promotionRank) != move.IsPromotion()) return false;
+
+	bool noisy = false;
+	if (move.flag == MoveFlag::EnPassantPossible) {
+		// Double push
+		if (GetSquareRank(move.from) != doublePushRank || move.to != move.from + 2 * forwardDelta) return false;
+		if (CheckBit(occupancy, move.from + forwardDelta) || CheckBit(occupancy, move.to)) return false;
+	}
+	else if (move.flag == MoveFlag::EnPassantPerformed) {
+		if (move.to != b.EnPassantSquare || !CheckBit(pawnAttacks, move.to)) return false;
+		noisy = true;
+	}
+	else if (move.flag == MoveFlag::None || move.IsPromotion()) {
+		// Captures on the en passant square are always flagged as such
+		if (move.to == b.EnPassantSquare) return false;
+		if (move.to == move.from + forwardDelta) {
+			if (CheckBit(occupancy, move.to)) return false;
+		}
+		else if (!capture || !CheckBit(pawnAttacks, move.to)) return false;
+		noisy = (move.flag == MoveFlag::PromotionToQueen) || (capture && !move.IsPromotion());
+	}
+	else return false;
+
+	return (moveGen == MoveGen::All) || ((moveGen == MoveGen::Noisy) == noisy);
+}
+
 // Threats and move legality ----------------------------------------------------------------------
 
 uint64_t Position::CalculateAttackedSquares(const bool attackingSide) const {
@@ -834,35 +935,72 @@ GameState Position::GetGameState() const {
 
 // Static exchange evaluation (SEE) ---------------------------------------------------------------
 
+
+namespace {
+	constexpr auto SeeValues = std::array{ 0, 100, 300, 300, 500, 1000, 999999 };
+
+	// The initial gain of the move, not yet accounting for the piece that is moving
+	inline int EstimatedSeeMoveValue(const Position& pos, const Move& move) {
+		if (move.IsCastling()) return 0;
+		if (move.flag == MoveFlag::EnPassantPerformed) return SeeValues[PieceType::Pawn];
+		int value = SeeValues[TypeOfPiece(pos.GetPieceAt(move.to))];
+		if (move.IsPromotion()) value += SeeValues[move.GetPromotionPieceType()] - SeeValues[PieceType::Pawn];
+		return value;
+	}
+}
+
+SeeContext Position::GetSeeContext() const {
+	const Board& b = States.back();
+	SeeContext context;
+	context.whitePieces = GetOccupancy(Side::White);
+	context.blackPieces = GetOccupancy(Side::Black);
+	context.parallels = b.WhiteRookBits | b.BlackRookBits | b.WhiteQueenBits | b.BlackQueenBits;
+	context.diagonals = b.WhiteBishopBits | b.BlackBishopBits | b.WhiteQueenBits | b.BlackQueenBits;
+	return context;
+}
+
+int Position::GetLeastValuableAttacker(const uint64_t attackers, const bool side) const {
+	const Board& b = States.back();
+	if (side == Side::White) {
+		if (attackers & b.WhitePawnBits) return LsbSquare(attackers & b.WhitePawnBits);
+		if (attackers & b.WhiteKnightBits) return LsbSquare(attackers & b.WhiteKnightBits);
+		if (attackers & b.WhiteBishopBits) return LsbSquare(attackers & b.WhiteBishopBits);
+		if (attackers & b.WhiteRookBits) return LsbSquare(attackers & b.WhiteRookBits);
+		if (attackers & b.WhiteQueenBits) return LsbSquare(attackers & b.WhiteQueenBits);
+		if (attackers & b.WhiteKingBits) return LsbSquare(attackers & b.WhiteKingBits);
+	}
+	else {
+		if (attackers & b.BlackPawnBits) return LsbSquare(attackers & b.BlackPawnBits);
+		if (attackers & b.BlackKnightBits) return LsbSquare(attackers & b.BlackKnightBits);
+		if (attackers & b.BlackBishopBits) return LsbSquare(attackers & b.BlackBishopBits);
+		if (attackers & b.BlackRookBits) return LsbSquare(attackers & b.BlackRookBits);
+		if (attackers & b.BlackQueenBits) return LsbSquare(attackers & b.BlackQueenBits);
+		if (attackers & b.BlackKingBits) return LsbSquare(attackers & b.BlackKingBits);
+	}
+	return -1;
+}
+
 bool Position::StaticExchangeEval(const Move& move, const int threshold) const {
+	return StaticExchangeEval(move, threshold, GetSeeContext());
+}
+
+bool Position::StaticExchangeEval(const Move& move, const int threshold, const SeeContext& context) const {
 	// This is more or less the standard way of doing this
 	// The implementation follows Ethereal's method
-
-	constexpr auto seeValues = std::array{ 0, 100, 300, 300, 500, 1000, 999999 };
+	const ScopedPhaseTimer timer(ProfilerPhase::SEE);
 
 	// Get the initial piece
 	uint8_t victim = TypeOfPiece(GetPieceAt(move.from));
 	if (move.IsPromotion()) victim = move.GetPromotionPieceType();
 
-	// Get estimated move value
-	int estimatedMoveValue = seeValues[TypeOfPiece(GetPieceAt(move.to))];
-	if (move.IsPromotion()) estimatedMoveValue += seeValues[move.GetPromotionPieceType()] - seeValues[PieceType::Pawn];
-	else if (move.flag == MoveFlag::EnPassantPerformed) estimatedMoveValue = seeValues[PieceType::Pawn];
-	else if (move.IsCastling()) estimatedMoveValue = 0;
-
 	// Handle trivial cases (losing the piece for nothing still above / having initial gain below threshold)
 	int score = -threshold;
-	score += estimatedMoveValue;
+	score += EstimatedSeeMoveValue(*this, move);
 	if (score < 0) return false;
-	score -= seeValues[victim];
+	score -= SeeValues[victim];
 	if (score >= 0) return true;
 
-	// Lookups (should be optimized) 
-	const uint64_t whitePieces = GetOccupancy(Side::White);
-	const uint64_t blackPieces = GetOccupancy(Side::Black);
-	const uint64_t parallels = WhiteRookBits() | BlackRookBits() | WhiteQueenBits() | BlackQueenBits();
-	const uint64_t diagonals = WhiteBishopBits() | BlackBishopBits() | WhiteQueenBits() | BlackQueenBits();
-	uint64_t occupancy = whitePieces | blackPieces;
+	uint64_t occupancy = context.whitePieces | context.blackPieces;
 	SetBitFalse(occupancy, move.from);
 	SetBitTrue(occupancy, move.to);
 	bool turn = Turn();
@@ -875,27 +1013,11 @@ bool Position::StaticExchangeEval(const Move& move, const int threshold) const {
 	// Pseudo-generating steps
 	while (true) {
 
-		uint64_t currentAttackers = attackers & ((turn == Side::White) ? whitePieces : blackPieces);
+		uint64_t currentAttackers = attackers & ((turn == Side::White) ? context.whitePieces : context.blackPieces);
 		if (!currentAttackers) break;
 
 		// Retrieve the location of the least valuable attacking piece type
-		int sq = -1;
-		if (turn == Side::White) {
-			if (currentAttackers & WhitePawnBits()) sq = LsbSquare(currentAttackers & WhitePawnBits());
-			else if (currentAttackers & WhiteKnightBits()) sq = LsbSquare(currentAttackers & WhiteKnightBits());
-			else if (currentAttackers & WhiteBishopBits()) sq = LsbSquare(currentAttackers & WhiteBishopBits());
-			else if (currentAttackers & WhiteRookBits()) sq = LsbSquare(currentAttackers & WhiteRookBits());
-			else if (currentAttackers & WhiteQueenBits()) sq = LsbSquare(currentAttackers & WhiteQueenBits());
-			else if (currentAttackers & WhiteKingBits()) sq = LsbSquare(currentAttackers & WhiteKingBits());
-		}
-		else {
-			if (currentAttackers & BlackPawnBits()) sq = LsbSquare(currentAttackers & BlackPawnBits());
-			else if (currentAttackers & BlackKnightBits()) sq = LsbSquare(currentAttackers & BlackKnightBits());
-			else if (currentAttackers & BlackBishopBits()) sq = LsbSquare(currentAttackers & BlackBishopBits());
-			else if (currentAttackers & BlackRookBits()) sq = LsbSquare(currentAttackers & BlackRookBits());
-			else if (currentAttackers & BlackQueenBits()) sq = LsbSquare(currentAttackers & BlackQueenBits());
-			else if (currentAttackers & BlackKingBits()) sq = LsbSquare(currentAttackers & BlackKingBits());
-		}
+		const int sq = GetLeastValuableAttacker(currentAttackers, turn);
 		assert(sq != -1);
 
 		// Update fields
@@ -904,19 +1026,19 @@ bool Position::StaticExchangeEval(const Move& move, const int threshold) const {
 
 		// Update potentially uncovered sliding pieces
 		if (victim == PieceType::Pawn || victim == PieceType::Bishop || victim == PieceType::Queen) {
-			attackers |= GetBishopAttacks(move.to, occupancy) & diagonals;
+			attackers |= GetBishopAttacks(move.to, occupancy) & context.diagonals;
 		}
 		if (victim == PieceType::Rook || victim == PieceType::Queen) {
-			attackers |= GetRookAttacks(move.to, occupancy) & parallels;
+			attackers |= GetRookAttacks(move.to, occupancy) & context.parallels;
 		}
 
 		attackers &= occupancy;
 		turn = !turn;
 
 		// Break conditions
-		score = -score - seeValues[victim] - 1;
+		score = -score - SeeValues[victim] - 1;
 		if (score >= 0) {
-			const uint64_t upcomingOccupancy = (turn == Side::White) ? whitePieces : blackPieces;
+			const uint64_t upcomingOccupancy = (turn == Side::White) ? context.whitePieces : context.blackPieces;
 			if (victim == PieceType::King && (currentAttackers & upcomingOccupancy)) {
 				turn = !turn;
 			}
@@ -927,3 +1049,54 @@ bool Position::StaticExchangeEval(const Move& move, const int threshold) const {
 	// If after the exchange it's our opponent's turn, that means we won
 	return turn != Turn();
 }
+
+int Position::StaticExchangeValue(const Move& move, const SeeContext& context) const {
+	// Swap list algorithm: play out the whole capture sequence on the target square with the least
+	// valuable attackers first, then walk it backwards, letting each side stop capturing when that's better
+	// StaticExchangeEval(move, threshold) is equivalent to StaticExchangeValue(move) >= threshold
+	const ScopedPhaseTimer timer(ProfilerPhase::SEE);
+
+	std::array<int, 34> gains;
+	gains[0] = EstimatedSeeMoveValue(*this, move);
+	int depth = 0;
+
+	uint8_t victim = TypeOfPiece(GetPieceAt(move.from));
+	if (move.IsPromotion()) victim = move.GetPromotionPieceType();
+
+	uint64_t occupancy = context.whitePieces | context.blackPieces;
+	SetBitFalse(occupancy, move.from);
+	SetBitTrue(occupancy, move.to);
+	bool turn = Turn();
+	if (move.flag == MoveFlag::EnPassantPerformed) {
+		SetBitFalse(occupancy, (turn == Side::White) ? move.to - 8 : move.to + 8);
+	}
+	turn = !turn;
+	uint64_t attackers = GetAttackersOfSquare(move.to, occupancy) & occupancy;
+
+	while (true) {
+		const uint64_t currentAttackers = attackers & ((turn == Side::White) ? context.whitePieces : context.blackPieces);
+		if (!currentAttackers) break;
+
+		// Capture the piece on the target square with the least valuable attacker
+		const int sq = GetLeastValuableAttacker(currentAttackers, turn);
+		assert(sq != -1);
+		depth += 1;
+		gains[depth] = SeeValues[victim] - gains[depth - 1];
+		victim = TypeOfPiece(GetPieceAt(sq));
+		SetBitFalse(occupancy, sq);
+
+		// Update potentially uncovered sliding pieces
+		if (victim == PieceType::Pawn || victim == PieceType::Bishop || victim == PieceType::Queen) {
+			attackers |= GetBishopAttacks(move.to, occupancy) & context.diagonals;
+		}
+		if (victim == PieceType::Rook || victim == PieceType::Queen) {
+			attackers |= GetRookAttacks(move.to, occupancy) & context.parallels;
+		}
+		attackers &= occupancy;
+		turn = !turn;
+	}
+
+	// Negamax the swap list: each side may choose not to continue the exchange
+	for (int i = depth; i > 0; i--) gains[i - 1] = std::min(gains[i - 1], -gains[i]);
+	return gains[0];
+}
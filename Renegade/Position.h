@@ -1,6 +1,7 @@
 #pragma once
 #include "Board.h"
 #include "Move.h"
+#include "Profiler.h"
 #include "Settings.h"
 #include "Utils.h"
 
@@ -10,6 +11,15 @@ uint64_t GetRookAttacks(const uint8_t square, const uint64_t occupancy);
 uint64_t GetQueenAttacks(const uint8_t square, const uint64_t occupancy);
 uint64_t GetConnectingRay(const uint8_t from, const uint64_t to);
 
+// Bitboards used by static exchange evaluation which don't depend on the move being evaluated
+// Calculating these once per position allows them to be shared between multiple SEE calls
+struct SeeContext {
+	uint64_t whitePieces = 0;
+	uint64_t blackPieces = 0;
+	uint64_t diagonals = 0;
+	uint64_t parallels = 0;
+};
+
 class Position
 {
 public:
@@ -17,6 +27,7 @@ public:
 	Position(const std::string& fen);
 	Position() : Position(FEN::StartPos) {};
 	Position(const int frcWhite, const int frcBlack);
+	Position(const Board& board, const CastlingConfiguration& castling);
 
 	void PushMove(const Move& move);
 	void PushNullMove();
@@ -27,6 +38,7 @@ public:
 	bool IsDrawn(const bool threefold) const;
 
 	bool IsLegalMove(const Move& m) const;
+	bool IsPseudoLegal(const Move& move, const MoveGen moveGen = MoveGen::All) const;
 	bool IsMoveQuiet(const Move& move) const;
 
 	inline Board& CurrentState() {
@@ -163,7 +175,11 @@ public:
 	uint64_t GetAttackersOfSquare(const uint8_t square, const uint64_t occupied) const;
 	std::string GetFEN() const;
 	GameState GetGameState() const;
+	uint64_t CalculateAttackedSquares(const bool attackingSide) const;
+	SeeContext GetSeeContext() const;
 	bool StaticExchangeEval(const Move& move, const int threshold) const;
+	bool StaticExchangeEval(const Move& move, const int threshold, const SeeContext& context) const;
+	int StaticExchangeValue(const Move& move, const SeeContext& context) const;
 
 	std::vector<Board> States{};
 	std::vector<uint64_t> Hashes{};
@@ -179,9 +195,10 @@ private:
 	template <bool side, MoveGen moveGen> void GenerateKingMoves(MoveList& moves, const int home) const;
 	template <bool side, MoveGen moveGen> void GeneratePawnMoves(MoveList& moves, const int home) const;
 	template <bool side> void GenerateCastlingMoves(MoveList& moves) const;
+	template <bool side> bool IsCastlingPossible(const bool shortCastle) const;
 	template <bool side, int pieceType, MoveGen moveGen> void GenerateSlidingMoves(MoveList& moves, const int home, const uint64_t whiteOccupancy, const uint64_t blackOccupancy) const;
 
+	int GetLeastValuableAttacker(const uint64_t attackers, const bool side) const;
 	bool IsSquareAttacked(const bool attackingSide, const uint8_t square, const uint64_t occupancy) const;
-	uint64_t CalculateAttackedSquares(const bool attackingSide) const;
 };
 
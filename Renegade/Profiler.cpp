@@ -0,0 +1,96 @@
+#include "Profiler.h"
+#include "Utils.h"
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+// Registry of per-thread counters ----------------------------------------------------------------
+
+namespace {
+	std::mutex RegistryMutex;
+	std::vector<ProfilerCounters*> Registry;
+	std::array<uint64_t, ProfilerPhaseCount> RetiredTicks{}; // results of threads which have exited already
+	std::array<uint64_t, ProfilerPhaseCount> RetiredCalls{};
+	uint64_t ResetTicks = ReadProfilerTicks();
+	std::chrono::steady_clock::time_point ResetTime = std::chrono::steady_clock::now();
+}
+
+ProfilerCounters::ProfilerCounters() {
+	if constexpr (!ProfilerEnabled) return;
+	std::lock_guard<std::mutex> lock(RegistryMutex);
+	Registry.push_back(this);
+}
+
+ProfilerCounters::~ProfilerCounters() {
+	if constexpr (!ProfilerEnabled) return;
+	std::lock_guard<std::mutex> lock(RegistryMutex);
+	std::erase(Registry, this);
+	for (int i = 0; i < ProfilerPhaseCount; i++) {
+		RetiredTicks[i] += Ticks[i];
+		RetiredCalls[i] += Calls[i];
+	}
+}
+
+void ProfilerCounters::Reset() {
+	Ticks.fill(0);
+	Calls.fill(0);
+	ChildTicks = 0;
+}
+
+// Collecting results -----------------------------------------------------------------------------
+
+void Profiler::Reset() {
+	std::lock_guard<std::mutex> lock(RegistryMutex);
+	for (ProfilerCounters* counters : Registry) counters->Reset();
+	RetiredTicks.fill(0);
+	RetiredCalls.fill(0);
+	ResetTicks = ReadProfilerTicks();
+	ResetTime = std::chrono::steady_clock::now();
+}
+
+ProfilerReport Profiler::Collect() {
+	std::lock_guard<std::mutex> lock(RegistryMutex);
+	ProfilerReport report{};
+	report.Ticks = RetiredTicks;
+	report.Calls = RetiredCalls;
+	for (const ProfilerCounters* counters : Registry) {
+		for (int i = 0; i < ProfilerPhaseCount; i++) {
+			report.Ticks[i] += counters->Ticks[i];
+			report.Calls[i] += counters->Calls[i];
+		}
+	}
+	report.ElapsedTicks = ReadProfilerTicks() - ResetTicks;
+	const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - ResetTime).count();
+	if (elapsedMs > 0.0 && report.ElapsedTicks != 0) report.TicksPerMs = report.ElapsedTicks / elapsedMs;
+	return report;
+}
+
+void Profiler::PrintBreakdown(const int threadCount, const bool uciOutput) {
+	if constexpr (!ProfilerEnabled) return;
+	const ProfilerReport report = Profiler::Collect();
+	const std::string prefix = uciOutput ? "info string " : "";
+	const double totalTicks = static_cast<double>(report.ElapsedTicks) * threadCount;
+
+	const std::ios_base::fmtflags oldFlags = cout.flags();
+	const std::streamsize oldPrecision = cout.precision();
+	cout << std::fixed << std::setprecision(1);
+
+	cout << prefix << "Profiler breakdown (self time in " << ProfilerTickUnit << ", " << threadCount << " thread"
+		<< (threadCount != 1 ? "s" : "") << ", " << report.ElapsedTicks / report.TicksPerMs << " ms):" << endl;
+	uint64_t measuredTicks = 0;
+	for (int i = 0; i < ProfilerPhaseCount; i++) {
+		const uint64_t perCall = (report.Calls[i] != 0) ? report.Ticks[i] / report.Calls[i] : 0;
+		cout << prefix << std::left << std::setw(18) << ProfilerPhaseNames[i] << std::right
+			<< " calls " << std::setw(15) << Console::FormatInteger(report.Calls[i])
+			<< "  per call " << std::setw(8) << perCall
+			<< "  total " << std::setw(10) << report.Ticks[i] / report.TicksPerMs << " ms"
+			<< "  " << std::setw(5) << report.Ticks[i] * 100.0 / std::max(totalTicks, 1.0) << "%" << endl;
+		measuredTicks += report.Ticks[i];
+	}
+	const double otherTicks = std::max(totalTicks - measuredTicks, 0.0);
+	cout << prefix << std::left << std::setw(18) << "other" << std::right << std::setw(59) << otherTicks / report.TicksPerMs << " ms"
+		<< "  " << std::setw(5) << otherTicks * 100.0 / std::max(totalTicks, 1.0) << "%" << endl;
+
+	cout.flags(oldFlags);
+	cout.precision(oldPrecision);
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define RENEGADE_PROFILER_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define RENEGADE_PROFILER_RDTSC
+#endif
+
+/*
+* A lightweight profiler measuring how much time is spent in different parts of the engine.
+* Only compiled in when RENEGADE_PROFILER is defined (e.g. 'make profiler=1'), otherwise the timers
+* are empty and the compiler removes them entirely.
+* Time is measured in cycles with rdtsc on x86, and in nanoseconds using steady_clock elsewhere.
+* Measurements are collected per thread, so they don't slow down the search with synchronization.
+* Each phase only counts its self time: e.g. time spent generating moves is excluded from the move
+* picker's time.
+*/
+
+#if defined(RENEGADE_PROFILER)
+constexpr bool ProfilerEnabled = true;
+#else
+constexpr bool ProfilerEnabled = false;
+#endif
+
+enum class ProfilerPhase { MakeMove, GenerateMoves, MovePicker, Evaluate, TTProbe, TTStore, SEE };
+constexpr int ProfilerPhaseCount = 7;
+
+constexpr std::array<const char*, ProfilerPhaseCount> ProfilerPhaseNames = {
+	"make/unmake move", "move generation", "move picker", "evaluation", "tt probe", "tt store", "see"
+};
+
+#if defined(RENEGADE_PROFILER_RDTSC)
+constexpr const char* ProfilerTickUnit = "cycles";
+#else
+constexpr const char* ProfilerTickUnit = "ns";
+#endif
+
+inline uint64_t ReadProfilerTicks() {
+#if defined(RENEGADE_PROFILER_RDTSC)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Per-thread counters, registered at the profiler so that they can be summed up
+struct ProfilerCounters {
+	ProfilerCounters();
+	~ProfilerCounters();
+	ProfilerCounters(const ProfilerCounters&) = delete;
+	ProfilerCounters& operator=(const ProfilerCounters&) = delete;
+
+	std::array<uint64_t, ProfilerPhaseCount> Ticks{};
+	std::array<uint64_t, ProfilerPhaseCount> Calls{};
+	uint64_t ChildTicks = 0;
+
+	void Reset();
+};
+
+// Summed up measurements of all threads since the last reset
+struct ProfilerReport {
+	std::array<uint64_t, ProfilerPhaseCount> Ticks{};
+	std::array<uint64_t, ProfilerPhaseCount> Calls{};
+	uint64_t ElapsedTicks = 0;
+	double TicksPerMs = 1e6;
+
+	inline double Milliseconds(const ProfilerPhase phase) const {
+		return Ticks[static_cast<int>(phase)] / TicksPerMs;
+	}
+};
+
+namespace Profiler {
+	inline thread_local ProfilerCounters Counters;
+
+	void Reset();
+	ProfilerReport Collect();
+	void PrintBreakdown(const int threadCount, const bool uciOutput);
+}
+
+class ScopedPhaseTimer {
+public:
+	explicit ScopedPhaseTimer(const ProfilerPhase phase) {
+		if constexpr (ProfilerEnabled) {
+			Phase = phase;
+			SavedChildTicks = Profiler::Counters.ChildTicks;
+			Profiler::Counters.ChildTicks = 0;
+			StartTicks = ReadProfilerTicks();
+		}
+	}
+
+	~ScopedPhaseTimer() {
+		if constexpr (ProfilerEnabled) {
+			const uint64_t elapsed = ReadProfilerTicks() - StartTicks;
+			ProfilerCounters& counters = Profiler::Counters;
+			counters.Ticks[static_cast<int>(Phase)] += elapsed - std::min(counters.ChildTicks, elapsed);
+			counters.Calls[static_cast<int>(Phase)] += 1;
+			counters.ChildTicks = SavedChildTicks + elapsed;
+		}
+	}
+
+	ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+	ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+private:
+	ProfilerPhase Phase{};
+	uint64_t StartTicks = 0;
+	uint64_t SavedChildTicks = 0;
+};
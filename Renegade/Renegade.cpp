@@ -9,10 +9,13 @@
 // - Histories      : collecting statistics about the game tree
 // - Transpositions : storing data about previously explored positions
 // - Move           : move representation
-// - Movepicker     : lazily sorting moves, currently very barebones
+// - Movepicker     : staged move generation and lazily sorting moves
 // - Classical      : handcrafted board evaluation (older and weaker, normally isn't used)
 // - Neural         : NNUE board evaluation (default)
 // - Datagen        : data generation tool for training NNUE networks
+// - Benchmark      : extended benchmarking tools (e.g. measuring multithreaded scaling)
+// - Profiler       : optional timing of the engine's internals
+// - Statistics     : optional counters for search techniques
 // - Reporting      : output structure used by search & displaying search results
 // - Magics         : magic bitboard lookups for sliding pieces
 // - Settings       : handling engine-wide options and parameter tuning
@@ -22,7 +25,7 @@
 
 int main(int argc, char* argv[]) {
 	std::srand(static_cast<unsigned int>(std::time(0)));
-	GenerateMagicTables();
+	InitializeSliderAttacks();
 	LoadDefaultNetwork();
 
 	Engine engine = Engine(argc, argv);
@@ -49,6 +49,8 @@ void PrintInfo(const Results& e) {
 	for (const Move& move : e.pv)
 		pvString += " " + move.ToString(Settings::Chess960);
 
+	const std::string multiPVOutput = (e.multiPV != 0) ? " multipv " + std::to_string(e.multiPV) : "";
+
 	std::string wdlOutput{};
 	if (Settings::ShowWDL) {
 		const auto [w, d, l] = GetWDL(e.score, e.ply);
@@ -56,12 +58,12 @@ void PrintInfo(const Results& e) {
 	}
 
 #if defined(_MSC_VER)
-	const std::string output = std::format("info depth {} seldepth {} score {}{} nodes {} nps {} time {} hashfull {} pv{}",
-		e.depth, e.seldepth, score, wdlOutput, e.nodes, e.nps, e.time, e.hashfull, pvString);
+	const std::string output = std::format("info depth {} seldepth {}{} score {}{} nodes {} nps {} time {} hashfull {} pv{}",
+		e.depth, e.seldepth, multiPVOutput, score, wdlOutput, e.nodes, e.nps, e.time, e.hashfull, pvString);
 
 #else
 	const std::string output = "info depth " + std::to_string(e.depth) + " seldepth " + std::to_string(e.seldepth)
-		+ " score " + score + wdlOutput + " nodes " + std::to_string(e.nodes) + " nps " + std::to_string(e.nps)
+		+ multiPVOutput + " score " + score + wdlOutput + " nodes " + std::to_string(e.nodes) + " nps " + std::to_string(e.nps)
 		+ " time " + std::to_string(e.time) + " hashfull " + std::to_string(e.hashfull)
 		+ " pv" + pvString;
 #endif
@@ -153,6 +155,7 @@ void PrintPretty(const Results& e) {
 #endif
 }
 
-void PrintBestmove(const Move& move) {
-	cout << "bestmove " << move.ToString(Settings::Chess960) << endl;
+void PrintBestmove(const Move& move, const Move& ponder) {
+	if (ponder.IsNull()) cout << "bestmove " << move.ToString(Settings::Chess960) << endl;
+	else cout << "bestmove " << move.ToString(Settings::Chess960) << " ponder " << ponder.ToString(Settings::Chess960) << endl;
 }
\ No newline at end of file
@@ -14,6 +14,7 @@ struct Results {
 	int ply = 0;
 	std::vector<Move> pv;
 	int threads = 1;
+	int multiPV = 0; // only reported when searching multiple lines
 
 	Results();
 	Results(const int score, const int depth, const int seldepth, const uint64_t nodes, const uint64_t time,
@@ -23,4 +24,4 @@ struct Results {
 
 void PrintInfo(const Results& e);
 void PrintPretty(const Results& e);
-void PrintBestmove(const Move& move);
+void PrintBestmove(const Move& move, const Move& ponder);
@@ -8,10 +8,11 @@
 // - LMR is quite conservative
 // - the ordering score can come either directly from history, or from captures/killers etc.
 // - quiescence search is very basic
-// - there aren't any form of staged movegen implemented
 // - some stuff are just plain cursed
 
-Search::Search() {
+Search::Search() : Search(SearchMode::Threaded) {}
+
+Search::Search(const SearchMode mode) : Mode(mode) {
 	constexpr double lmrMultiplier = 0.4;
 	constexpr double lmrBase = 0.7;
 	for (int i = 1; i < 32; i++) {
@@ -19,13 +20,22 @@ Search::Search() {
 			LMRTable[i][j] = static_cast<int>(lmrMultiplier * std::log(i) * std::log(j) + lmrBase);
 		}
 	}
-	StartThreads(1);
+
+	if (Mode == SearchMode::Threaded) StartThreads(1);
+	else Threads.emplace_back().threadId = 0; // the data is used by the caller's thread, nothing is started
+}
+
+Search::~Search() {
+	if (Mode == SearchMode::Threaded) StopThreads();
 }
 
 void ThreadData::ResetStatistics() {
 	RootDepth = 0;
 	SelDepth = 0;
 	Nodes = 0;
+	TTProbes = 0;
+	TTHits = 0;
+	Stats.Reset();
 }
 
 void Search::ResetState(const bool clearTT) {
@@ -34,6 +44,7 @@ void Search::ResetState(const bool clearTT) {
 }
 
 void Search::StartThreads(const int threadCount) {
+	assert(Mode == SearchMode::Threaded);
 	assert(Threads.size() == 0);
 	LoadedThreadCount.store(0);
 	for (int i = 0; i < threadCount; i++) {
@@ -45,6 +56,7 @@ void Search::StartThreads(const int threadCount) {
 }
 
 void Search::StopThreads() {
+	assert(Mode == SearchMode::Threaded);
 	StopSearch();
 	for (ThreadData& t : Threads) {
 		std::unique_lock<std::mutex> lock(t.Mutex);
@@ -62,6 +74,7 @@ void Search::SetThreadCount(const int threadCount) {
 }
 
 Results Search::SearchSinglethreaded(const Position& pos, const SearchParams& params) {
+	StartSearchTime = Clock::now();
 	Aborting.store(false);
 	TranspositionTable.IncreaseAge();
 	ThreadData& t = Threads.front();
@@ -73,13 +86,17 @@ Results Search::SearchSinglethreaded(const Position& pos, const SearchParams& pa
 
 	SearchMoves(t);
 	t.singlethreaded = false;
+	LastStatistics = t.Stats;
 	return t.result;
 }
 
 void Search::StartSearch(Position& position, const SearchParams params, const bool display) {
+	assert(Mode == SearchMode::Threaded);
 
 	StartSearchTime = Clock::now();
 	TranspositionTable.IncreaseAge();
+	DisplayOutput = display;
+	if constexpr (ProfilerEnabled) Profiler::Reset();
 
 	MoveList rootLegalMoves{};
 	position.GenerateMoves(rootLegalMoves, MoveGen::All, Legality::Legal);
@@ -87,20 +104,41 @@ void Search::StartSearch(Position& position, const SearchParams params, const bo
 	// Handle no legal moves
 	if (rootLegalMoves.size() == 0) {
 		cout << "info string No legal moves!" << endl;
-		PrintBestmove(NullMove);
+		PrintBestmove(NullMove, NullMove);
 		return;
 	}
 
-	// Early exit for only one legal move
-	if (rootLegalMoves.size() == 1 && !DatagenMode && (params.wtime != 0 || params.btime != 0)) {
-		const Move onlyMove = rootLegalMoves[0].move;
-		cout << "info string Only one legal move!" << endl;
+	// Restrict the root to the moves given by 'go searchmoves', unless none of them are legal
+	std::vector<Move> rootMoves{};
+	for (const ScoredMove& m : rootLegalMoves) {
+		if (params.searchmoves.empty() || std::find(params.searchmoves.begin(), params.searchmoves.end(), m.move.Pack()) != params.searchmoves.end()) {
+			rootMoves.push_back(m.move);
+		}
+	}
+	const bool ignoreSearchMoves = rootMoves.empty();
+	if (ignoreSearchMoves) {
+		cout << "info string None of the searchmoves are legal, searching all moves" << endl;
+		for (const ScoredMove& m : rootLegalMoves) rootMoves.push_back(m.move);
+	}
+
+	// Early exit for only one legal move (or only one searchmove)
+	if (rootMoves.size() == 1 && !DatagenMode && !params.ponder && (params.wtime != 0 || params.btime != 0)) {
+		const Move onlyMove = rootMoves.front();
+		if (rootLegalMoves.size() == 1) cout << "info string Only one legal move!" << endl;
+		else cout << "info string Only one searchmove!" << endl;
 		cout << "info depth 1 nodes 0 pv " << onlyMove.ToString(Settings::Chess960) << endl;
-		PrintBestmove(onlyMove);
+		PrintBestmove(onlyMove, NullMove);
 		return;
 	}
 
 	Constraints = CalculateConstraints(params, position.Turn());
+	if (ignoreSearchMoves) Constraints.SearchMoves.clear();
+
+	// While pondering there are no time limits, they are only set on 'ponderhit'
+	PonderParams = params;
+	PonderTurn = position.Turn();
+	HoldBestmove = params.ponder || params.infinite;
+	Pondering.store(params.ponder);
 
 	// Fire up the threads
 	Aborting.store(false);
@@ -123,6 +161,20 @@ void Search::StopSearch() {
 	WaitUntilReady();
 }
 
+void Search::PonderHit() {
+	if (!Pondering.load()) return;
+
+	// The search continues with the time limits of the original 'go' command, counting from the start of pondering
+	// The threads only read the time limits after seeing the pondering flag cleared
+	SearchParams params = PonderParams;
+	params.ponder = false;
+	const SearchConstraints constraints = CalculateConstraints(params, PonderTurn);
+	Constraints.SearchTimeMin = constraints.SearchTimeMin;
+	Constraints.SearchTimeMax = constraints.SearchTimeMax;
+	HoldBestmove = params.infinite;
+	Pondering.store(false, std::memory_order_release);
+}
+
 void Search::Loop(ThreadData& t) {
 	LoadedThreadCount.fetch_add(1);
 
@@ -132,9 +184,10 @@ void Search::Loop(ThreadData& t) {
 		t.CondVar.wait(lock, [&] { return t.Action != ThreadAction::Sleep; });
 
 		if (t.Action == ThreadAction::Exit) break;
+		else if (t.Action == ThreadAction::Perft) PerftRootMoves(t);
 		else {
 			SearchMoves(t);
-			if (t.IsMainThread()) PrintBestmove(t.result.BestMove());
+			if (t.IsMainThread() && DisplayOutput) PrintBestmove(t.result.BestMove(), GetPonderMove(t));
 		}
 
 		t.Action = ThreadAction::Sleep;
@@ -155,6 +208,16 @@ void Search::WaitUntilReady() {
 	}
 }
 
+Results Search::GetLastResults() const {
+	// Aggregated results of the last finished multithreaded search
+	return LastResults;
+}
+
+SearchStatistics Search::GetLastStatistics() const {
+	// Merged search statistics of the last finished search (only collected when enabled)
+	return LastStatistics;
+}
+
 
 // Time management --------------------------------------------------------------------------------
 
@@ -165,12 +228,21 @@ SearchConstraints Search::CalculateConstraints(const SearchParams params, const
 	if (params.nodes != 0) constraints.MaxNodes = params.nodes;
 	if (params.softnodes != 0) constraints.SoftNodes = params.softnodes;
 	if (params.depth != 0) constraints.MaxDepth = params.depth;
+	constraints.MultiPV = std::max(params.multiPV, 1);
+	constraints.SearchMoves = params.searchmoves;
+
+	// If no mate is found, the fallback search is limited to the depth of the mate by default
+	if (params.mate > 0) {
+		constraints.MateMoves = params.mate;
+		if (params.depth == 0) constraints.MaxDepth = std::min(params.mate * 2, MaxDepth - 1);
+	}
 	if (params.movetime != 0) {
 		constraints.SearchTimeMin = params.movetime;
 		constraints.SearchTimeMax = params.movetime;
 	}
 	if (constraints.MaxDepth != -1 || constraints.MaxNodes != -1) return constraints;
 	if (constraints.SearchTimeMin != -1 || constraints.SearchTimeMax != -1) return constraints;
+	if (params.ponder) return constraints;
 
 	// Handle wtime, btime, winc, binc
 	const int myTime = turn ? params.wtime : params.btime;
@@ -207,7 +279,7 @@ bool Search::ShouldAbort(const ThreadData& t) {
 		Aborting.store(true, std::memory_order_relaxed);
 		return true;
 	}
-	if ((t.Nodes % 1024 == 0) && (Constraints.SearchTimeMax != -1) && (t.RootDepth > 1)) {
+	if ((t.Nodes % 1024 == 0) && !Pondering.load(std::memory_order_acquire) && (Constraints.SearchTimeMax != -1) && (t.RootDepth > 1)) {
 		const auto now = Clock::now();
 		const int elapsedMs = static_cast<int>((now - StartSearchTime).count() / 1e6);
 		if (elapsedMs >= Constraints.SearchTimeMax) {
@@ -236,68 +308,99 @@ void Search::SearchMoves(ThreadData& t) {
 
 	// Iterative deepening
 	t.result.ply = t.CurrentPosition.GetPly();
-	int score = NoEval;
-	bool finished = false;
+
+	// For 'go mate' the main thread tries to prove a mate first, and only falls back to a regular search without one
+	const bool mateFound = t.IsMainThread() && (Constraints.MateMoves != 0) && SearchMate(t);
+	bool finished = mateFound;
+
+	// With multi-PV the root is searched repeatedly in each iteration, excluding the moves of the lines found so far
+	MoveList rootMoves{};
+	t.CurrentPosition.GenerateMoves(rootMoves, MoveGen::All, Legality::Legal);
+	const int rootMoveCount = static_cast<int>(std::count_if(rootMoves.begin(), rootMoves.end(), [&](const ScoredMove& m) { return IsSearchedRootMove(t, m.move); }));
+	const int lineCount = std::clamp(Constraints.MultiPV, 1, std::max(rootMoveCount, 1));
+	std::vector<Results> lines(lineCount);
+	std::vector<int> lineScores(lineCount, NoEval);
+	t.RootLines.clear();
 
 	while (!finished) {
-		t.ResetPvTable();
 		t.RootDepth += 1;
 		t.SelDepth = 0;
+		t.RootExcludedMoves.clear();
 
-		// Obtain score
-		if (t.RootDepth < 5) {
-			// Regular negamax for shallow depths
-			score = SearchRecursive(t, t.RootDepth, 0, NegativeInfinity, PositiveInfinity, true, false);
-		}
-		else {
-			// Aspiration windows
-			int windowSize = 20;
-			int searchDepth = t.RootDepth;
-
-			while (true) {
-				if (Aborting.load(std::memory_order_relaxed)) break;
-				int alpha, beta;
-				if (windowSize < 500) {
-					alpha = std::max(score - windowSize, NegativeInfinity);
-					beta = std::min(score + windowSize, PositiveInfinity);
-				}
-				else {
-					alpha = NegativeInfinity;
-					beta = PositiveInfinity;
-				}
-
-				//if (!settings.UciOutput) cout << "[" << alpha << ".." << beta << "] ";
+		for (int line = 0; line < lineCount; line++) {
+			t.ResetPvTable();
+			int score = lineScores[line];
 
-				score = SearchRecursive(t, searchDepth, 0, alpha, beta, true, false);
-
-				if (score <= alpha) {
-					alpha = std::max(alpha - windowSize, NegativeInfinity);
-					beta = (alpha + beta) / 2;
-					searchDepth = t.RootDepth;
-				}
-				else if (score >= beta) {
-					beta = std::min(beta + windowSize, PositiveInfinity);
-					
-					// Reduce depth on fail-high
-					if (!IsMateScore(score) && (searchDepth > 1)) searchDepth -= 1;
-				}
-				else {
-					// Success!
-					break;
+			// Obtain score
+			if (t.RootDepth < 5) {
+				// Regular negamax for shallow depths
+				score = SearchRecursive(t, t.RootDepth, 0, NegativeInfinity, PositiveInfinity, true, false);
+			}
+			else {
+				// Aspiration windows
+				int windowSize = 20;
+				int searchDepth = t.RootDepth;
+
+				while (true) {
+					if (Aborting.load(std::memory_order_relaxed)) break;
+					int alpha, beta;
+					if (windowSize < 500) {
+						alpha = std::max(score - windowSize, NegativeInfinity);
+						beta = std::min(score + windowSize, PositiveInfinity);
+					}
+					else {
+						alpha = NegativeInfinity;
+						beta = PositiveInfinity;
+					}
+
+					//if (!settings.UciOutput) cout << "[" << alpha << ".." << beta << "] ";
+
+					score = SearchRecursive(t, searchDepth, 0, alpha, beta, true, false);
+
+					if (score <= alpha) {
+						alpha = std::max(alpha - windowSize, NegativeInfinity);
+						beta = (alpha + beta) / 2;
+						searchDepth = t.RootDepth;
+					}
+					else if (score >= beta) {
+						beta = std::min(beta + windowSize, PositiveInfinity);
+
+						// Reduce depth on fail-high
+						if (!IsMateScore(score) && (searchDepth > 1)) searchDepth -= 1;
+					}
+					else {
+						// Success!
+						break;
+					}
+
+					windowSize += windowSize / 2;
 				}
 
-				windowSize += windowSize / 2;
 			}
 
+			if (Aborting.load(std::memory_order_relaxed) && t.RootDepth > 1) break;
+			lines[line].score = score;
+			lines[line].pv = t.GeneratePvLine();
+			t.RootExcludedMoves.push_back(lines[line].BestMove());
+		}
+		t.RootExcludedMoves.clear();
+
+		// Later lines may occasionally come back with a better score due to search instability
+		if (lineCount > 1) {
+			std::stable_sort(lines.begin(), lines.end(), [](const Results& a, const Results& b) { return a.score > b.score; });
+			for (int line = 0; line < lineCount; line++) lineScores[line] = lines[line].score;
+		}
+		else {
+			lineScores[0] = lines[0].score;
 		}
 
 		// Check search limits on the main thread
 		const auto currentTime = Clock::now();
 		const int elapsedMs = static_cast<int>((currentTime - StartSearchTime).count() / 1e6);
-		if (t.IsMainThread()) {
+		if (t.IsMainThread() && !Pondering.load(std::memory_order_acquire)) {
 			if (Constraints.SearchTimeMin != -1 && Constraints.SearchTimeMin != Constraints.SearchTimeMax) {
 				const int originalSoftTimeLimit = Constraints.SearchTimeMin;
-				const Move& bestMove = t.PvTable[0][0];
+				const Move bestMove = lines[0].BestMove();
 				const double bestMoveFraction = t.RootNodeCounts[bestMove.from][bestMove.to] / static_cast<double>(t.Nodes);
 				const int adjustedSoftTimeLimit = originalSoftTimeLimit * (t.RootDepth >= 10 ? (1.5 - bestMoveFraction) * 1.35 : 1.0);
 				if (elapsedMs >= adjustedSoftTimeLimit) finished = true;
@@ -308,7 +411,7 @@ void Search::SearchMoves(ThreadData& t) {
 		if (t.RootDepth >= MaxDepth) finished = true;
 		if ((t.Nodes >= Constraints.SoftNodes) && (Constraints.SoftNodes != -1)) finished = true;
 
-		if (Aborting.load(std::memory_order_relaxed) && !t.singlethreaded && t.RootDepth > 1) {
+		if (Aborting.load(std::memory_order_relaxed) && t.RootDepth > 1) {
 			t.result.nodes = t.Nodes;
 			t.result.time = elapsedMs;
 			t.result.nps = static_cast<int>(t.Nodes * 1e9 / (currentTime - StartSearchTime).count());
@@ -317,7 +420,7 @@ void Search::SearchMoves(ThreadData& t) {
 		}
 
 		// Save info
-		t.result.score = score;
+		t.result.score = lines[0].score;
 		t.result.depth = t.RootDepth;
 		t.result.seldepth = t.SelDepth;
 
@@ -325,23 +428,108 @@ void Search::SearchMoves(ThreadData& t) {
 		t.result.time = elapsedMs;
 		t.result.nps = static_cast<int>(t.Nodes * 1e9 / (currentTime - StartSearchTime).count());
 		t.result.hashfull = TranspositionTable.GetHashfull();
+		t.result.pv = lines[0].pv;
 
-		// Obtaining PV line and displaying
-		t.result.pv = t.GeneratePvLine();
-		if (t.IsMainThread() && !t.singlethreaded) {
-			if (!finished) PrintInfo(AggregateThreadResults());
+		for (int line = 0; line < lineCount; line++) {
+			lines[line].depth = t.RootDepth;
+			lines[line].ply = t.result.ply;
+		}
+		t.RootLines = lines;
+
+		// Displaying
+		if (t.IsMainThread() && !t.singlethreaded && DisplayOutput) {
+			if (!finished) PrintRootLines(AggregateThreadResults());
 		}
 	}
 
 	// Main thread should wait others finishing before displaying the final best move
 	if (t.IsMainThread() && !t.singlethreaded) {
+		// The best move can't be sent before 'ponderhit' or 'stop' when pondering or searching infinitely
+		while ((HoldBestmove || Pondering.load()) && !Aborting.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
 		Aborting.store(true);
 		while (ActiveThreadCount.load() > 1) {};
-		PrintInfo(AggregateThreadResults());
+		LastResults = AggregateThreadResults();
+		LastStatistics = AggregateThreadStatistics();
+		if (DisplayOutput) PrintRootLines(LastResults);
+		if (DisplayOutput && ProfilerEnabled) Profiler::PrintBreakdown(Threads.size(), true);
 	}
 
 }
 
+SearchStatistics Search::AggregateThreadStatistics() const {
+	SearchStatistics sumStatistics{};
+	for (const ThreadData& t : Threads) sumStatistics.Merge(t.Stats);
+	return sumStatistics;
+}
+
+bool Search::SearchMate(ThreadData& t) {
+	MateSolver solver([&](const uint64_t nodes) {
+		if (Aborting.load(std::memory_order_relaxed)) return true;
+		if ((Constraints.MaxNodes != -1) && (t.Nodes + nodes >= static_cast<uint64_t>(Constraints.MaxNodes))) return true;
+		// The time limits are only read once pondering is over, as they are written on ponderhit
+		if (!Pondering.load(std::memory_order_acquire) && (Constraints.SearchTimeMax != -1)) {
+			const int elapsedMs = static_cast<int>((Clock::now() - StartSearchTime).count() / 1e6);
+			if (elapsedMs >= Constraints.SearchTimeMax) return true;
+		}
+		return false;
+	});
+	const MateSearchResult mate = solver.Solve(t.CurrentPosition, Constraints.MateMoves, [&](const Move& move) { return IsSearchedRootMove(t, move); });
+	t.Nodes += mate.nodes;
+	if (mate.moves == 0 || mate.pv.empty()) return false;
+
+	const auto currentTime = Clock::now();
+	const uint64_t elapsedNs = std::max((currentTime - StartSearchTime).count(), int64_t{1});
+	t.RootDepth = 2 * mate.moves - 1;
+	t.SelDepth = t.RootDepth;
+	t.result.score = MateEval - t.RootDepth;
+	t.result.depth = t.RootDepth;
+	t.result.seldepth = t.RootDepth;
+	t.result.nodes = t.Nodes;
+	t.result.time = elapsedNs / 1'000'000;
+	t.result.nps = static_cast<uint64_t>(t.Nodes * 1e9 / elapsedNs);
+	t.result.hashfull = TranspositionTable.GetHashfull();
+	t.result.pv = mate.pv;
+	return true;
+}
+
+// The expected reply for pondering: the second move of the PV, or the hash move after the best move
+Move Search::GetPonderMove(const ThreadData& t) const {
+	const std::vector<Move>& pv = t.result.pv;
+	if (pv.size() >= 2) return pv[1];
+	if (pv.empty()) return NullMove;
+
+	Position position = t.CurrentPosition;
+	position.PushMove(pv[0]);
+	TranspositionEntry entry;
+	if (!TranspositionTable.Probe(position.Hash(), entry, 0)) return NullMove;
+	const Move move = Move(entry.packedMove);
+	if (move.IsNull() || !position.IsPseudoLegal(move) || !position.IsLegalMove(move)) return NullMove;
+	return move;
+}
+
+// Root moves can be restricted by 'go searchmoves', and multi-PV excludes the moves of the lines already found
+bool Search::IsSearchedRootMove(const ThreadData& t, const Move& move) const {
+	const std::vector<uint16_t>& allowed = Constraints.SearchMoves;
+	if (!allowed.empty() && std::find(allowed.begin(), allowed.end(), move.Pack()) == allowed.end()) return false;
+	return std::find(t.RootExcludedMoves.begin(), t.RootExcludedMoves.end(), move) == t.RootExcludedMoves.end();
+}
+
+// With multi-PV the lines of the main thread are reported, together with the statistics of all threads
+void Search::PrintRootLines(const Results& aggregate) const {
+	const std::vector<Results>& lines = Threads.front().RootLines;
+	if (lines.size() <= 1) {
+		PrintInfo(aggregate);
+		return;
+	}
+	for (std::size_t i = 0; i < lines.size(); i++) {
+		Results r = aggregate;
+		r.score = lines[i].score;
+		r.pv = lines[i].pv;
+		r.multiPV = static_cast<int>(i + 1);
+		PrintInfo(r);
+	}
+}
+
 Results Search::AggregateThreadResults() const {
 	Results sumResult{};
 
@@ -415,13 +603,16 @@ int Search::SearchRecursive(ThreadData& t, int depth, const int level, int alpha
 
 	if (!singularSearch) {
 		found = TranspositionTable.Probe(hash, ttEntry, level);
+		t.TTProbes += 1;
 		if (found) {
+			t.TTHits += 1;
 			if (!pvNode) {
 				// The branch was already analyzed to the same or greater depth, so we can return the result if the score is alright
 				if (ttEntry.IsCutoffPermitted(depth, alpha, beta)) return ttEntry.score;
 			}
 			ttEval = ttEntry.score;
 			ttMove = Move(ttEntry.packedMove);
+			if (!position.IsPseudoLegal(ttMove)) ttMove = NullMove; // e.g. hash collisions
 		}
 	}
 
@@ -466,7 +657,10 @@ int Search::SearchRecursive(ThreadData& t, int depth, const int level, int alpha
 		// Reverse futility pruning
 		if (depth <= 7 && !IsMateScore(beta)) {
 			const int rfpMargin = depth * 90 - improving * 90;
-			if (eval - rfpMargin > beta) return (eval + beta) / 2;
+			if (eval - rfpMargin > beta) {
+				t.Stats.Increment(SearchStat::ReverseFutilityPruning);
+				return (eval + beta) / 2;
+			}
 		}
 
 		// Null-move pruning
@@ -476,12 +670,14 @@ int Search::SearchRecursive(ThreadData& t, int depth, const int level, int alpha
 				const int defaultReduction = 4 + depth / 3 + std::min((eval - beta) / 200, 3);
 				return std::min(defaultReduction, depth);
 			}();
+			t.Stats.Increment(SearchStat::NullMoveAttempts);
 			position.PushNullMove();
 			t.EvalState.PushState(position, NullMove, Piece::None, Piece::None);
 			const int nmpScore = -SearchRecursive(t, depth - nmpReduction, level + 1, -beta, -beta + 1, false, !cutNode);
 			position.PopMove();
 			t.EvalState.PopState();
 			if (nmpScore >= beta) {
+				t.Stats.Increment(SearchStat::NullMoveCutoffs);
 				return IsMateScore(nmpScore) ? beta : nmpScore;
 			}
 		}
@@ -520,6 +716,7 @@ int Search::SearchRecursive(ThreadData& t, int depth, const int level, int alpha
 	while (movePicker.HasNext()) {
 		const auto& [m, order] = movePicker.Get();
 		if (m == excludedMove) continue;
+		if (rootNode && !IsSearchedRootMove(t, m)) continue;
 		if (!position.IsLegalMove(m)) continue;
 		legalMoveCount += 1;
 		const bool isQuiet = position.IsMoveQuiet(m);
@@ -533,11 +730,15 @@ int Search::SearchRecursive(ThreadData& t, int depth, const int level, int alpha
 			// Late-move pruning
 			if (depth <= 4 && isQuiet && !inCheck) {
 				const int lmpCount = 3 + depth * (depth - !improving);
-				if (legalMoveCount > lmpCount) break;
+				if (legalMoveCount > lmpCount) {
+					t.Stats.Increment(SearchStat::LateMovePruning);
+					break;
+				}
 			}
 
 			// Performing futility pruning
 			if (isQuiet && order < 32768 && alpha < MateThreshold && futilityPrunable) {
+				t.Stats.Increment(SearchStat::FutilityPruning);
 				bestScore = (bestScore + alpha) / 2;
 				break;
 			}
@@ -545,7 +746,10 @@ int Search::SearchRecursive(ThreadData& t, int depth, const int level, int alpha
 			// Main search SEE pruning
 			if (depth <= 5) {
 				const int seeMargin = isQuiet ? (-50 * depth) : (-100 * depth);
-				if (!position.StaticExchangeEval(m, seeMargin)) continue;
+				if (!movePicker.StaticExchangeEval(seeMargin)) {
+					t.Stats.Increment(SearchStat::SEEPruning);
+					continue;
+				}
 			}
 		}
 
@@ -555,20 +759,28 @@ int Search::SearchRecursive(ThreadData& t, int depth, const int level, int alpha
 			const int singularMargin = depth * 2;
 			const int singularBeta = std::max(ttEval - singularMargin, -MateEval);
 			const int singularDepth = (depth - 1) / 2;
+			t.Stats.Increment(SearchStat::SingularAttempts);
 			t.ExcludedMoves[level] = m;
 			const int singularScore = SearchRecursive(t, singularDepth, level, singularBeta - 1, singularBeta, false, cutNode);
 			t.ExcludedMoves[level] = NullMove;
-			t.MovePickerStack[level].index = 1;
+			t.MovePickerStack[level].Rewind();
 				
 			if (singularScore < singularBeta) {
 				// Successful extension
 				const bool doubleExtend = (!pvNode && (singularScore < singularBeta - 30)) || t.SuperSingular[level];
 				extension = 1 + doubleExtend;
+				t.Stats.Increment(doubleExtend ? SearchStat::DoubleExtensions : SearchStat::SingularExtensions);
 			}
 			else {
 				// Extension check failed
-				if (!pvNode && singularBeta >= beta) return singularBeta;
-				else if (cutNode) extension = -1;
+				if (!pvNode && singularBeta >= beta) {
+					t.Stats.Increment(SearchStat::MultiCuts);
+					return singularBeta;
+				}
+				else if (cutNode) {
+					t.Stats.Increment(SearchStat::NegativeExtensions);
+					extension = -1;
+				}
 			}
 		}
 
@@ -597,10 +809,12 @@ int Search::SearchRecursive(ThreadData& t, int depth, const int level, int alpha
 			reduction = std::max(reduction, 0);
 
 			const int reducedDepth = std::clamp(depth - 1 - reduction, 0, depth - 1);
+			t.Stats.Increment(SearchStat::LMRSearches);
 			score = -SearchRecursive(t, reducedDepth, level + 1, -alpha - 1, -alpha, false, true);
 
 			if (score > alpha && reducedDepth < depth - 1) {
 				deepen = score > (bestScore + 50 + (depth - 1) * 5);
+				t.Stats.Increment(SearchStat::LMRResearches);
 				score = -SearchRecursive(t, depth - 1 + deepen, level + 1, -alpha - 1, -alpha, false, !cutNode);
 			}
 		}
@@ -687,8 +901,9 @@ int Search::SearchRecursive(ThreadData& t, int depth, const int level, int alpha
 		if (updateCorrection) t.History.UpdateCorrection(position, (rawEval + staticEval) / 2, bestScore, depth);
 	}
 
-	// Store node search results into the transposition table
-	if (!aborting && !singularSearch) {
+	// Store node search results into the transposition table (unless the root moves were restricted)
+	const bool restrictedRoot = rootNode && (!t.RootExcludedMoves.empty() || !Constraints.SearchMoves.empty());
+	if (!aborting && !singularSearch && !restrictedRoot) {
 		TranspositionTable.Store(hash, depth, bestScore, scoreType, rawEval, bestMove, level, ttPV);
 	}
 
@@ -711,6 +926,8 @@ int Search::SearchQuiescence(ThreadData& t, const int level, int alpha, int beta
 	const uint64_t hash = position.Hash();
 	TranspositionEntry ttEntry;
 	const bool found = TranspositionTable.Probe(hash, ttEntry, level);
+	t.TTProbes += 1;
+	t.TTHits += found;
 	if (!pvNode && found && ttEntry.IsCutoffPermitted(0, alpha, beta)) return ttEntry.score;
 	Move ttMove = NullMove;
 	if (found) ttMove = Move(ttEntry.packedMove);
@@ -722,7 +939,10 @@ int Search::SearchQuiescence(ThreadData& t, const int level, int alpha, int beta
 		return static_cast<int16_t>(Evaluate(t, position, level));
 	}();
 	const int staticEval = t.History.ApplyCorrection(position, rawEval);
-	if (staticEval >= beta) return staticEval;
+	if (staticEval >= beta) {
+		t.Stats.Increment(SearchStat::QSearchStandPats);
+		return staticEval;
+	}
 	if (staticEval > alpha) alpha = staticEval;
 	if (level >= MaxDepth) return staticEval;
 	if (position.IsDrawn(false)) return DrawEvaluation(t);
@@ -739,7 +959,11 @@ int Search::SearchQuiescence(ThreadData& t, const int level, int alpha, int beta
 	while (movePicker.HasNext()) {
 		const auto& [m, order] = movePicker.Get();
 		if (!position.IsLegalMove(m)) continue;
-		if (!position.StaticExchangeEval(m, 0)) continue; // Quiescence search SEE pruning
+		if (!movePicker.StaticExchangeEval(0)) {
+			// Quiescence search SEE pruning
+			t.Stats.Increment(SearchStat::QSearchSEESkips);
+			continue;
+		}
 		t.Nodes += 1;
 
 		const uint8_t movedPiece = position.GetPieceAt(m.from);
@@ -811,45 +1035,86 @@ void ThreadData::ResetPvTable() {
 
 // Perft methods ----------------------------------------------------------------------------------
 
-void Search::Perft(Position& position, const int depth, const PerftType type) const {
+void Search::Perft(const Position& position, const int depth, const PerftType type, const int hashMegabytes) {
+	assert(Mode == SearchMode::Threaded);
 	const bool isStartpos = position.Hash() == 0x463b96181691fc9c;
 	constexpr std::array<uint64_t, 8> startposPerfts = { 1, 20, 400, 8902, 197281, 4865609, 119060324, 3195901860 };
 
 	const auto startTime = Clock::now();
-	const uint64_t r = PerftRecursive(position, depth, depth, type);
+	PerftHashTable.SetSize(hashMegabytes);
+
+	MoveList rootMoves{};
+	position.GenerateMoves(rootMoves, MoveGen::All, Legality::Legal);
+	PerftMoves.clear();
+	for (const auto& m : rootMoves) PerftMoves.push_back(m.move);
+	PerftCounts.assign(PerftMoves.size(), 0);
+	PerftNextMove.store(0);
+	PerftDepth = depth - 1;
+
+	// Split the root moves between the search threads
+	if (depth > 1) {
+		ActiveThreadCount.store(Threads.size());
+		for (ThreadData& t : Threads) t.CurrentPosition = position;
+		for (ThreadData& t : Threads) {
+			std::unique_lock<std::mutex> lock(t.Mutex);
+			t.Action = ThreadAction::Perft;
+			lock.unlock();
+			t.CondVar.notify_one();
+		}
+		WaitUntilReady();
+	}
+	else std::fill(PerftCounts.begin(), PerftCounts.end(), (depth == 1) ? 1 : 0);
+
+	const uint64_t r = (depth != 0) ? std::accumulate(PerftCounts.begin(), PerftCounts.end(), uint64_t{ 0 }) : 1;
 	const auto endTime = Clock::now();
+	PerftHashTable.SetSize(0);
+
+	if (type == PerftType::PerftDiv) {
+		cout << "-> Legal moves (" << PerftMoves.size() << "): " << endl;
+		for (std::size_t i = 0; i < PerftMoves.size(); i++)
+			cout << " - " << PerftMoves[i].ToString(Settings::Chess960) << " : " << PerftCounts[i] << endl;
+	}
 
 	const float seconds = static_cast<float>((endTime - startTime).count() / 1e9);
 	const float speed = r / seconds / 1000000;
 	cout << "-> Perft(" << depth << ") = " << Console::FormatInteger(r) << " | "
 		<< std::setprecision(2) << std::fixed << seconds << " s | "
-		<< std::setprecision(3) << speed << " mnps | No bulk counting" << endl;
+		<< std::setprecision(3) << speed << " mnps | Bulk counting, " << Threads.size() << " thread" << (Threads.size() != 1 ? "s" : "");
+	if (hashMegabytes > 0) cout << ", " << hashMegabytes << " MB hash";
+	cout << endl;
 
 	if (isStartpos && depth < startposPerfts.size() && startposPerfts[depth] != r)
 		cout << "-> Uh-oh. (expected: " << Console::FormatInteger(startposPerfts[depth]) << ")" << endl;
 }
 
-uint64_t Search::PerftRecursive(Position& position, const int depth, const int originalDepth, const PerftType type) const {
+void Search::PerftRootMoves(ThreadData& t) {
+	// Each thread takes the next unclaimed root move until none are left
+	while (true) {
+		const int i = PerftNextMove.fetch_add(1);
+		if (i >= static_cast<int>(PerftMoves.size())) break;
+		t.CurrentPosition.PushMove(PerftMoves[i]);
+		PerftCounts[i] = PerftRecursive(t.CurrentPosition, PerftDepth);
+		t.CurrentPosition.PopMove();
+	}
+}
+
+uint64_t Search::PerftRecursive(Position& position, const int depth) {
+	if (depth == 0) return 1;
+
 	MoveList moves{};
-	position.GenerateMoves(moves, MoveGen::All, Legality::Pseudolegal);
+	position.GenerateMoves(moves, MoveGen::All, Legality::Legal);
+	if (depth == 1) return moves.size(); // bulk counting
 
-	if (type == PerftType::PerftDiv && originalDepth == depth) cout << "-> Legal moves (" << moves.size() << "): " << endl;
 	uint64_t count = 0;
+	const bool hashing = PerftHashTable.IsEnabled();
+	if (hashing && PerftHashTable.Probe(position.Hash(), depth, count)) return count;
+
 	for (const auto& m : moves) {
-		if (!position.IsLegalMove(m.move)) continue;
-		uint64_t r;
-		if (depth == 1) {
-			r = 1;
-			count += 1;
-		}
-		else {
-			position.PushMove(m.move);
-			r = PerftRecursive(position, depth - 1, originalDepth, type);
-			position.PopMove();
-			count += r;
-		}
-		if (originalDepth == depth && type == PerftType::PerftDiv)
-			cout << " - " << m.move.ToString(Settings::Chess960) << " : " << r << endl;
+		position.PushMove(m.move);
+		count += PerftRecursive(position, depth - 1);
+		position.PopMove();
 	}
+
+	if (hashing) PerftHashTable.Store(position.Hash(), depth, count);
 	return count;
 }
@@ -1,9 +1,11 @@
 #pragma once
 #include "Histories.h"
+#include "MateSearch.h"
 #include "Movepicker.h"
 #include "Neural.h"
 #include "Position.h"
 #include "Reporting.h"
+#include "Statistics.h"
 #include "Transpositions.h"
 #include "Utils.h"
 #include <atomic>
@@ -14,6 +16,7 @@
 //#include <format>
 #include <list>
 #include <mutex>
+#include <numeric>
 #include <random>
 #include <thread>
 #include <tuple>
@@ -23,7 +26,12 @@
 * SearchRecursive() is the main alpha-beta search, and SearchQuiescence() is called in leaf nodes.
 */
 
-enum class ThreadAction { Sleep, Search, Exit };
+enum class ThreadAction { Sleep, Search, Perft, Exit };
+
+// Threaded: owns a pool of sleeping threads that StartSearch() and Perft() wake up (used for UCI play)
+// Synchronous: a lightweight search context without any threads of its own, which can only be searched on
+// the caller's thread via SearchSinglethreaded() (for running many independent games or analyses at once)
+enum class SearchMode { Threaded, Synchronous };
 
 class alignas(64) ThreadData {
 public:
@@ -31,6 +39,8 @@ public:
 
 	int RootDepth = 0, SelDepth = 0;
 	uint64_t Nodes = 0;
+	uint64_t TTProbes = 0, TTHits = 0;
+	SearchStatistics Stats;
 	Histories History;
 	MultiArray<Move, MaxDepth + 1, MaxDepth + 1> PvTable;
 	std::array<int, MaxDepth + 1> PvLength;
@@ -50,6 +60,8 @@ public:
 	std::array<int, MaxDepth> CutoffCount;
 	std::array<Move, MaxDepth> ExcludedMoves;
 	std::array<bool, MaxDepth> SuperSingular;
+	std::vector<Move> RootExcludedMoves;
+	std::vector<Results> RootLines; // completed lines of the last iteration, best first
 
 	Position CurrentPosition;
 
@@ -65,7 +77,7 @@ public:
 	// Thread handling
 	std::mutex Mutex;
 	std::condition_variable CondVar;
-	ThreadAction Action;
+	ThreadAction Action = ThreadAction::Sleep;
 	bool Exited = false;
 };
 
@@ -73,6 +85,8 @@ class Search
 {
 public:
 	Search();
+	explicit Search(const SearchMode mode);
+	~Search();
 	void ResetState(const bool clearTT);
 
 	void StartThreads(const int threadCount);
@@ -80,36 +94,64 @@ public:
 	void SetThreadCount(const int threadCount);
 	void StartSearch(Position& position, const SearchParams params, const bool display);
 	void StopSearch();
+	void PonderHit();
 	void Loop(ThreadData& t);
 	Results SearchSinglethreaded(const Position& pos, const SearchParams& params);
 	void WaitUntilReady();
+	Results GetLastResults() const;
+	SearchStatistics GetLastStatistics() const;
 
-	void Perft(Position& position, const int depth, const PerftType type) const;
+	void Perft(const Position& position, const int depth, const PerftType type, const int hashMegabytes);
 
 	std::atomic<bool> Aborting = true;
 	bool DatagenMode = false;
+	bool DisplayOutput = true;
 	Transpositions TranspositionTable;
 
 	std::list<ThreadData> Threads;
 	std::atomic<int> ActiveThreadCount = 0;
 	std::atomic<int> LoadedThreadCount = 0;
 
+	inline bool IsSynchronous() const {
+		return Mode == SearchMode::Synchronous;
+	}
+
 private:
 	Results AggregateThreadResults() const;
+	SearchStatistics AggregateThreadStatistics() const;
+	void PrintRootLines(const Results& aggregate) const;
+	bool IsSearchedRootMove(const ThreadData& t, const Move& move) const;
+	Move GetPonderMove(const ThreadData& t) const;
+	bool SearchMate(ThreadData& t);
 
 	void SearchMoves(ThreadData& t);
 	int SearchRecursive(ThreadData& t, int depth, const int level, int alpha, int beta, const bool pvNode, const bool cutNode);
 	int SearchQuiescence(ThreadData& t, const int level, int alpha, int beta, const bool pvNode);
 
 	int16_t Evaluate(ThreadData& t, const Position& position, const int level);
-	uint64_t PerftRecursive(Position& position, const int depth, const int originalDepth, const PerftType type) const;
+	void PerftRootMoves(ThreadData& t);
+	uint64_t PerftRecursive(Position& position, const int depth);
 	SearchConstraints CalculateConstraints(const SearchParams params, const bool turn) const;
 	bool ShouldAbort(const ThreadData& t);
 	int DrawEvaluation(const ThreadData& t) const;
 
 	
+	SearchMode Mode = SearchMode::Threaded;
 	SearchConstraints Constraints;
+	SearchParams PonderParams;
+	bool PonderTurn = Side::White;
+	std::atomic<bool> Pondering = false;
+	std::atomic<bool> HoldBestmove = false;
 	std::chrono::high_resolution_clock::time_point StartSearchTime;
+	Results LastResults;
+	SearchStatistics LastStatistics;
 	MultiArray<int, 32, 32> LMRTable;
 
+	// Perft state shared between threads, root moves are handed out one by one
+	std::vector<Move> PerftMoves;
+	std::vector<uint64_t> PerftCounts;
+	std::atomic<int> PerftNextMove = 0;
+	int PerftDepth = 0;
+	PerftTable PerftHashTable;
+
 };
@@ -3,6 +3,7 @@
 namespace Settings {
 	int Hash = HashDefault;
 	int Threads = ThreadsDefault;
+	int MultiPV = MultiPVDefault;
 	bool ShowWDL = ShowWDLDefault;
 	bool UseUCI = false;
 	bool Chess960 = Chess960Default;
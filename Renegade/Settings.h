@@ -12,12 +12,16 @@ constexpr int HashMax = 65536;
 constexpr int ThreadsMin = 1;
 constexpr int ThreadsDefault = 1;
 constexpr int ThreadsMax = 256;
+constexpr int MultiPVMin = 1;
+constexpr int MultiPVDefault = 1;
+constexpr int MultiPVMax = 256;
 constexpr bool Chess960Default = false;
 constexpr bool ShowWDLDefault = true;
 
 namespace Settings {
 	extern int Hash;
 	extern int Threads;
+	extern int MultiPV;
 	extern bool ShowWDL;
 	extern bool UseUCI;
 	extern bool Chess960;
@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+/*
+* Counters for how often each search technique is triggered, which helps understanding where the
+* nodes go. Only compiled in when RENEGADE_STATS is defined (e.g. 'make stats=1'), otherwise the
+* increments are optimized away entirely.
+* Each search thread has its own counters, these are merged when the search finishes.
+*/
+
+#if defined(RENEGADE_STATS)
+constexpr bool StatisticsEnabled = true;
+#else
+constexpr bool StatisticsEnabled = false;
+#endif
+
+enum class SearchStat {
+	ReverseFutilityPruning, NullMoveAttempts, NullMoveCutoffs, FutilityPruning, LateMovePruning, SEEPruning,
+	SingularAttempts, SingularExtensions, DoubleExtensions, NegativeExtensions, MultiCuts,
+	LMRSearches, LMRResearches, QSearchStandPats, QSearchSEESkips
+};
+constexpr int SearchStatCount = 15;
+
+// Names used for reporting (also as keys in JSON output)
+constexpr std::array<const char*, SearchStatCount> SearchStatNames = {
+	"rfp", "nmp_attempts", "nmp_cutoffs", "futility", "lmp", "see_pruning",
+	"se_attempts", "se_extensions", "se_double_extensions", "se_negative_extensions", "se_multicuts",
+	"lmr_searches", "lmr_researches", "qs_standpats", "qs_see_skips"
+};
+
+struct SearchStatistics {
+	std::array<uint64_t, SearchStatCount> Counts{};
+
+	inline void Increment(const SearchStat stat) {
+		if constexpr (StatisticsEnabled) Counts[static_cast<int>(stat)] += 1;
+	}
+
+	inline void Merge(const SearchStatistics& other) {
+		for (int i = 0; i < SearchStatCount; i++) Counts[i] += other.Counts[i];
+	}
+
+	inline void Reset() {
+		Counts.fill(0);
+	}
+};
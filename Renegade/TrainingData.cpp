@@ -0,0 +1,133 @@
+#include "TrainingData.h"
+
+namespace {
+	constexpr uint8_t CastlingRookNibble = 7;
+	constexpr uint8_t NoEnPassantSquare = 64;
+}
+
+// Binary formats ---------------------------------------------------------------------------------
+
+uint8_t PackOutcome(const GameState outcome) {
+	switch (outcome) {
+	case GameState::WhiteVictory: return 2;
+	case GameState::BlackVictory: return 0;
+	default: return 1;
+	}
+}
+
+GameState UnpackOutcome(const uint8_t outcome) {
+	switch (outcome) {
+	case 2: return GameState::WhiteVictory;
+	case 0: return GameState::BlackVictory;
+	default: return GameState::Drawn;
+	}
+}
+
+PackedPosition PackPosition(const Position& pos, const int16_t whiteScore, const GameState outcome) {
+	const Board& b = pos.CurrentState();
+	PackedPosition packed{};
+
+	uint64_t castlingRooks = 0;
+	if (b.WhiteRightToShortCastle) SetBitTrue(castlingRooks, pos.CastlingConfig.WhiteShortCastleRookSquare);
+	if (b.WhiteRightToLongCastle) SetBitTrue(castlingRooks, pos.CastlingConfig.WhiteLongCastleRookSquare);
+	if (b.BlackRightToShortCastle) SetBitTrue(castlingRooks, pos.CastlingConfig.BlackShortCastleRookSquare);
+	if (b.BlackRightToLongCastle) SetBitTrue(castlingRooks, pos.CastlingConfig.BlackLongCastleRookSquare);
+
+	packed.Occupancy = pos.GetOccupancy();
+	uint64_t occupancy = packed.Occupancy;
+	int index = 0;
+	while (occupancy != 0) {
+		const uint8_t square = Popsquare(occupancy);
+		uint8_t piece = b.GetPieceAt(square);
+		if (CheckBit(castlingRooks, square)) piece = (piece & Piece::BlackPieceOffset) | CastlingRookNibble;
+		packed.Pieces[index / 2] |= piece << ((index % 2) * 4);
+		index += 1;
+	}
+
+	const uint8_t enPassant = (b.EnPassantSquare == -1) ? NoEnPassantSquare : b.EnPassantSquare;
+	packed.TurnAndEnPassant = ((b.Turn == Side::Black) ? 0x80 : 0) | enPassant;
+	packed.HalfmoveClock = b.HalfmoveClock;
+	packed.FullmoveClock = b.FullmoveClock;
+	packed.Score = whiteScore;
+	packed.Outcome = PackOutcome(outcome);
+	return packed;
+}
+
+Position UnpackPosition(const PackedPosition& packed) {
+	Board board{};
+	CastlingConfiguration castling = { 0, 7, 56, 63 };
+
+	uint64_t occupancy = packed.Occupancy;
+	uint64_t castlingRooks = 0;
+	int index = 0;
+	while (occupancy != 0) {
+		const uint8_t square = Popsquare(occupancy);
+		uint8_t piece = (packed.Pieces[index / 2] >> ((index % 2) * 4)) & 0b1111;
+		if (TypeOfPiece(piece) == CastlingRookNibble) {
+			piece = (piece & Piece::BlackPieceOffset) | PieceType::Rook;
+			SetBitTrue(castlingRooks, square);
+		}
+		board.AddPiece(piece, square);
+		index += 1;
+	}
+
+	// Castling rights are determined by which side of the king the rook is on
+	while (castlingRooks != 0) {
+		const uint8_t square = Popsquare(castlingRooks);
+		const bool white = board.GetPieceAt(square) == Piece::WhiteRook;
+		const int kingFile = GetSquareFile(LsbSquare(white ? board.WhiteKingBits : board.BlackKingBits));
+		const bool shortCastle = GetSquareFile(square) > kingFile;
+		if (white && shortCastle) { board.WhiteRightToShortCastle = true; castling.WhiteShortCastleRookSquare = square; }
+		if (white && !shortCastle) { board.WhiteRightToLongCastle = true; castling.WhiteLongCastleRookSquare = square; }
+		if (!white && shortCastle) { board.BlackRightToShortCastle = true; castling.BlackShortCastleRookSquare = square; }
+		if (!white && !shortCastle) { board.BlackRightToLongCastle = true; castling.BlackLongCastleRookSquare = square; }
+	}
+
+	const uint8_t enPassant = packed.TurnAndEnPassant & 0x7F;
+	board.Turn = (packed.TurnAndEnPassant & 0x80) ? Side::Black : Side::White;
+	board.EnPassantSquare = (enPassant == NoEnPassantSquare) ? -1 : enPassant;
+	board.HalfmoveClock = packed.HalfmoveClock;
+	board.FullmoveClock = packed.FullmoveClock;
+	return Position(board, castling);
+}
+
+// Text format ------------------------------------------------------------------------------------
+
+std::string ToTextFormat(const std::string& fen, const int16_t whiteScore, const GameState outcome) {
+	const std::string outcomeStr = [&] {
+		switch (outcome) {
+		case GameState::WhiteVictory: return "1.0";
+		case GameState::BlackVictory: return "0.0";
+		case GameState::Drawn: return "0.5";
+		default: return "???";
+		}
+	}();
+	return fen + " | " + std::to_string(whiteScore) + " | " + outcomeStr;
+}
+
+bool ParseTextFormat(const std::string& line, std::string& fen, int16_t& whiteScore, GameState& outcome) {
+	const std::size_t first = line.find(" | ");
+	const std::size_t second = (first != std::string::npos) ? line.find(" | ", first + 3) : std::string::npos;
+	if (second == std::string::npos) return false;
+
+	const char* scoreStart = line.data() + first + 3;
+	const char* scoreEnd = line.data() + second;
+	const auto [end, error] = std::from_chars(scoreStart, scoreEnd, whiteScore);
+	if (error != std::errc() || end != scoreEnd) return false;
+
+	const std::string outcomeStr = line.substr(second + 3);
+	if (outcomeStr.starts_with("1.0")) outcome = GameState::WhiteVictory;
+	else if (outcomeStr.starts_with("0.5")) outcome = GameState::Drawn;
+	else if (outcomeStr.starts_with("0.0")) outcome = GameState::BlackVictory;
+	else return false;
+
+	fen = line.substr(0, first);
+	return true;
+}
+
+TrainingDataFormat GetTrainingDataFormat(const std::string& filename) {
+	if (EndsWith(filename, ".txt")) return TrainingDataFormat::Text;
+	if (EndsWith(filename, ".bin")) return TrainingDataFormat::Packed;
+	if (EndsWith(filename, ".games")) return TrainingDataFormat::Games;
+	return TrainingDataFormat::Unknown;
+}
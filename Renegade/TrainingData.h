@@ -0,0 +1,52 @@
+#pragma once
+#include "Position.h"
+#include "Utils.h"
+#include <array>
+#include <charconv>
+#include <string>
+
+/*
+* Storage formats for the training data produced by datagen.
+* - Text: '<fen> | <eval> | <wdl>' lines, eval is in centipawns from white's perspective,
+*   the outcome is 1.0 for a white win, 0.5 for a draw and 0.0 for a black win
+* - Packed positions: a fixed 32 bytes per position (see PackedPosition)
+* - Games: the starting position as a PackedPosition, followed by a move and a search score for each
+*   move played, terminated by a null move. Positions are restored by replaying the moves, so each
+*   position costs 4 bytes. This is what datagen writes, converting it to the other formats applies
+*   the filtering of positions.
+* The binary formats are stored in little-endian byte order.
+*/
+
+enum class TrainingDataFormat { Text, Packed, Games, Unknown };
+
+// Occupancy bitboard, and a nibble for each occupied square in order (starting from A1, low nibble first)
+// The nibbles use Renegade's piece encoding, with 7 / 15 marking a white / black rook with castling rights
+struct PackedPosition {
+	uint64_t Occupancy = 0;
+	std::array<uint8_t, 16> Pieces{};
+	uint8_t TurnAndEnPassant = 0; // 0x80 set for black to move, the rest is the en passant square (64 for none)
+	uint8_t HalfmoveClock = 0;
+	uint16_t FullmoveClock = 0;
+	int16_t Score = 0; // white's perspective
+	uint8_t Outcome = 0; // 0: black win, 1: draw, 2: white win
+	uint8_t Unused = 0;
+};
+
+struct PackedMoveAndScore {
+	uint16_t Move = 0;
+	int16_t Score = 0; // white's perspective
+};
+
+static_assert(sizeof(PackedPosition) == 32);
+static_assert(sizeof(PackedMoveAndScore) == 4);
+
+uint8_t PackOutcome(const GameState outcome);
+GameState UnpackOutcome(const uint8_t outcome);
+PackedPosition PackPosition(const Position& pos, const int16_t whiteScore, const GameState outcome);
+Position UnpackPosition(const PackedPosition& packed);
+
+std::string ToTextFormat(const std::string& fen, const int16_t whiteScore, const GameState outcome);
+bool ParseTextFormat(const std::string& line, std::string& fen, int16_t& whiteScore, GameState& outcome);
+
+// Decided by the extension: '.txt', '.bin' or '.games'
+TrainingDataFormat GetTrainingDataFormat(const std::string& filename);
@@ -8,6 +8,7 @@ void Transpositions::Store(const uint64_t hash, const int depth, const int16_t s
 
 	//assert(std::abs(score) < MateEval); <-- only good if not aborting
 	assert(HashMask != 0);
+	const ScopedPhaseTimer timer(ProfilerPhase::TTStore);
 	if (std::abs(score) > MateEval) return;
 
 	const uint64_t key = hash & HashMask;
@@ -64,6 +65,7 @@ void Transpositions::Store(const uint64_t hash, const int depth, const int16_t s
 
 bool Transpositions::Probe(const uint64_t hash, TranspositionEntry& returned, const int level) const {
 	assert(HashMask != 0);
+	const ScopedPhaseTimer timer(ProfilerPhase::TTProbe);
 	const uint64_t key = GetClusterIndex(hash);
 	const uint32_t storedHash = GetStoredHash(hash);
 	const TranspositionCluster& cluster = Table[key];
@@ -120,3 +122,28 @@ int Transpositions::GetHashfull() const {
 	}
 	return hashfull / 4;
 }
+
+// Perft hash table -------------------------------------------------------------------------------
+
+void PerftTable::SetSize(const int megabytes) {
+	// Zero megabytes releases the table
+	Table.reset();
+	Size = (megabytes > 0) ? std::bit_floor(static_cast<uint64_t>(megabytes) * 1024 * 1024 / sizeof(PerftEntry)) : 0;
+	if (Size != 0) Table = std::make_unique<PerftEntry[]>(Size);
+}
+
+bool PerftTable::Probe(const uint64_t hash, const int depth, uint64_t& count) const {
+	const uint64_t key = GetKey(hash, depth);
+	const PerftEntry& entry = Table[key & (Size - 1)];
+	const uint64_t storedCount = entry.count.load(std::memory_order_relaxed);
+	if ((entry.check.load(std::memory_order_relaxed) ^ storedCount) != key || storedCount == 0) return false;
+	count = storedCount;
+	return true;
+}
+
+void PerftTable::Store(const uint64_t hash, const int depth, const uint64_t count) {
+	const uint64_t key = GetKey(hash, depth);
+	PerftEntry& entry = Table[key & (Size - 1)];
+	entry.check.store(key ^ count, std::memory_order_relaxed);
+	entry.count.store(count, std::memory_order_relaxed);
+}
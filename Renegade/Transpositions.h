@@ -1,8 +1,10 @@
 #pragma once
 #include "Move.h"
+#include "Profiler.h"
 #include "Utils.h"
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <memory>
 
 namespace ScoreType {
@@ -66,3 +68,31 @@ private:
 	}
 };
 
+// Perft hash table -------------------------------------------------------------------------------
+
+// Stores node counts by position and remaining depth, the count is xored into the stored key,
+// so that a torn entry written by multiple threads at once fails to match instead of giving wrong results
+struct PerftEntry {
+	std::atomic<uint64_t> check = 0;
+	std::atomic<uint64_t> count = 0;
+};
+
+class PerftTable
+{
+public:
+	void SetSize(const int megabytes);
+	bool Probe(const uint64_t hash, const int depth, uint64_t& count) const;
+	void Store(const uint64_t hash, const int depth, const uint64_t count);
+
+	inline bool IsEnabled() const {
+		return Size != 0;
+	}
+
+private:
+	std::unique_ptr<PerftEntry[]> Table;
+	uint64_t Size = 0;
+
+	inline uint64_t GetKey(const uint64_t hash, const int depth) const {
+		return hash ^ (static_cast<uint64_t>(depth) * 0x9E3779B97F4A7C15);
+	}
+};
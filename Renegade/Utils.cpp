@@ -21,6 +21,10 @@ bool StartsWith(const std::string& big, const std::string& small) {
 	return big.compare(0, small.length(), small) == 0;
 }
 
+bool EndsWith(const std::string& big, const std::string& small) {
+	return big.length() >= small.length() && big.compare(big.length() - small.length(), small.length(), small) == 0;
+}
+
 void ConvertToLowercase(std::string& str) {
 	for (int x = 0; x < str.length(); x++) str[x] = tolower(str[x]);
 }
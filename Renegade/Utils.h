@@ -171,7 +171,7 @@ enum class GameState { Playing, WhiteVictory, BlackVictory, Drawn };
 
 enum class PerftType { Normal, PerftDiv };
 
-enum class MoveGen { All, Noisy };
+enum class MoveGen { All, Noisy, Quiet }; // noisy: captures & queen promotions, quiet: everything else
 
 enum class Legality { Legal, Pseudolegal };
 
@@ -184,9 +184,12 @@ struct SearchParams {
 	int nodes = 0;
 	int depth = 0;
 	bool infinite = false;
+	bool ponder = false;
 	int movetime = 0;
 	int softnodes = 0;
-	// + mate, searchmoves...
+	int multiPV = 1;
+	std::vector<uint16_t> searchmoves; // packed moves, searching every move if empty
+	int mate = 0;
 };
 
 struct SearchConstraints {
@@ -195,6 +198,9 @@ struct SearchConstraints {
 	int SearchTimeMin = -1;
 	int SearchTimeMax = -1;
 	int64_t SoftNodes = -1;
+	int MultiPV = 1;
+	std::vector<uint16_t> SearchMoves;
+	int MateMoves = 0;
 };
 
 // Bitwise operations  ----------------------------------------------------------------------------
@@ -287,6 +293,7 @@ constexpr uint64_t MurmurHash3(uint64_t key) {
 void ConvertToLowercase(std::string& str);
 std::string Trim(const std::string& str);
 bool StartsWith(const std::string& big, const std::string& small);
+bool EndsWith(const std::string& big, const std::string& small);
 std::vector<std::string> Split(const std::string& cmd);
 void PrintBitboard(const uint64_t bits);
 